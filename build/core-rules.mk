@@ -7,6 +7,7 @@ THIS_CORE := $(CORE)
 
 # Default tools
 IVERILOG ?= iverilog
+VERILATOR ?= verilator
 
 ECP5_INCLUDES ?= -I$(shell yosys-config --datdir/ecp5/)
 ECP5_LIBS ?= $(shell yosys-config --datdir/ecp5/cells_sim.v)
@@ -49,6 +50,14 @@ $(BUILD_TMP)/%_tb: sim/%_tb.v $(ECP5_LIBS) $(CORE_ALL_PREREQ) $(CORE_ALL_RTL_SRC
 		$(addprefix -l, $(ECP5_LIBS) $(CORE_ALL_RTL_SRCS) $(CORE_ALL_SIM_SRCS)) \
 		$<
 
+# Verilator (>= 5.0 for --timing), same plusargs as the iverilog one
+$(BUILD_TMP)/%_tb_vl: sim/%_tb.v $(ECP5_LIBS) $(CORE_ALL_PREREQ) $(CORE_ALL_RTL_SRCS) $(CORE_ALL_SIM_SRCS)
+	$(VERILATOR) --binary --timing -Wno-fatal -Wno-lint -Wno-style -DSIM=1 \
+		--top-module $(notdir $(basename $<)) --Mdir $@.d -o $@ \
+		$(CORE_SYNTH_INCLUDES) $(CORE_SIM_INCLUDES) $(ECP5_INCLUDES) \
+		$(ECP5_LIBS) $(CORE_ALL_RTL_SRCS) $(CORE_ALL_SIM_SRCS) \
+		$<
+
 
 # Action targets
 sim: $(addprefix $(BUILD_TMP)/, $(TESTBENCHES_$(THIS_CORE)))
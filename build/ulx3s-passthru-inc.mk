@@ -24,4 +24,4 @@ $(BUILDDIR)/$(PROJ_PASSTHRU).bit: $(BUILDDIR)/$(PROJ_PASSTHRU).config
 	ecppack --compress $^ $@
 
 $(BUILDDIR)/$(PROJ_PASSTHRU).bit.gz: $(BUILDDIR)/$(PROJ_PASSTHRU).bit
-	./gzip4k.py $< $@
+	./mbpack.py $< $@
@@ -16,6 +16,7 @@ RTL_SRCS_misc = $(addprefix rtl/, \
 	uart_wb.v \
 	xclk_strobe.v \
 	xclk_wb.v \
+	xclk_wb_pipe.v \
 )
 
 TESTBENCHES_misc := \
@@ -23,6 +24,7 @@ TESTBENCHES_misc := \
 	pdm_tb \
 	uart_tb \
 	uart_irda_tb \
+	xclk_wb_tb \
 	$(NULL)
 
 include $(ROOT)/build/core-magic.mk
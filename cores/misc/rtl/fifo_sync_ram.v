@@ -35,7 +35,8 @@
 
 module fifo_sync_ram #(
 	parameter integer DEPTH = 256,
-	parameter integer WIDTH = 16
+	parameter integer WIDTH = 16,
+	parameter integer FWFT = 1		// 0 = rd_data valid the cycle after rd_ena
 )(
 	input  wire [WIDTH-1:0] wr_data,
 	input  wire wr_ena,
@@ -45,6 +46,13 @@ module fifo_sync_ram #(
 	input  wire rd_ena,
 	output wire rd_empty,
 
+	// Fill level and thresholds (optional)
+	output reg  [$clog2(DEPTH):0] level,
+	input  wire [$clog2(DEPTH):0] afull_thr,
+	output reg  wr_afull,		// level >= afull_thr
+	input  wire [$clog2(DEPTH):0] aempty_thr,
+	output reg  rd_aempty,		// level <= aempty_thr
+
 	input  wire clk,
 	input  wire rst
 );
@@ -65,7 +73,7 @@ module fifo_sync_ram #(
 	wire ram_rd_ena;
 
 	// Fill-level
-	reg  [AWIDTH:0] level;
+	reg  [AWIDTH:0] ram_level;
 	(* keep="true" *) wire lvl_dec;
 	(* keep="true" *) wire lvl_mov;
 	wire lvl_empty;
@@ -77,6 +85,9 @@ module fifo_sync_ram #(
 	// Read logic
 	reg  rd_valid;
 
+	// User level
+	wire [AWIDTH:0] level_nxt;
+
 
 	// Fill level counter
 	// ------------------
@@ -84,19 +95,34 @@ module fifo_sync_ram #(
 
 	always @(posedge clk or posedge rst)
 		if (rst)
-			level <= {(AWIDTH+1){1'b1}};
+			ram_level <= {(AWIDTH+1){1'b1}};
 		else
-			level <= level + { {AWIDTH{lvl_dec}}, lvl_mov };
+			ram_level <= ram_level + { {AWIDTH{lvl_dec}}, lvl_mov };
 
 	assign lvl_dec = ram_rd_ena & ~ram_wr_ena;
 	assign lvl_mov = ram_rd_ena ^  ram_wr_ena;
-	assign lvl_empty = level[AWIDTH];
+	assign lvl_empty = ram_level[AWIDTH];
+
+	// Words available to the reader (output register included) and
+	// registered thresholds flags
+	assign level_nxt = level + (wr_ena & ~wr_full) - (rd_ena & ~rd_empty);
+
+	always @(posedge clk or posedge rst)
+		if (rst) begin
+			level     <= 0;
+			wr_afull  <= 1'b0;
+			rd_aempty <= 1'b1;
+		end else begin
+			level     <= level_nxt;
+			wr_afull  <= (level_nxt >= afull_thr);
+			rd_aempty <= (level_nxt <= aempty_thr);
+		end
 
 
 	// Full flag generation
 	// --------------------
 
-	assign full_nxt = level == { 1'b0, {(AWIDTH-2){1'b1}}, 2'b01 };
+	assign full_nxt = ram_level == { 1'b0, {(AWIDTH-2){1'b1}}, 2'b01 };
 
 	always @(posedge clk or posedge rst)
 		if (rst)
@@ -129,16 +155,29 @@ module fifo_sync_ram #(
 		else if (ram_rd_ena)
 			ram_rd_addr <= ram_rd_addr + 1;
 
-	assign ram_rd_ena = (rd_ena | ~rd_valid) & ~lvl_empty;
+	if (FWFT) begin
+		// Keep the RAM output register loaded, the head word is always
+		// presented on rd_data and rd_ena pops it
+		assign ram_rd_ena = (rd_ena | ~rd_valid) & ~lvl_empty;
 
-	always @(posedge clk or posedge rst)
-		if (rst)
-			rd_valid <= 1'b0;
-		else if (rd_ena | ~rd_valid)
-			rd_valid <= ~lvl_empty;
+		always @(posedge clk or posedge rst)
+			if (rst)
+				rd_valid <= 1'b0;
+			else if (rd_ena | ~rd_valid)
+				rd_valid <= ~lvl_empty;
+
+		assign rd_empty = ~rd_valid;
+	end else begin
+		// Standard: rd_ena reads the RAM, data is there the next cycle
+		assign ram_rd_ena = rd_ena & ~lvl_empty;
+
+		always @(posedge clk)
+			rd_valid <= ram_rd_ena;
+
+		assign rd_empty = lvl_empty;
+	end
 
 	assign rd_data = ram_rd_data;
-	assign rd_empty = ~rd_valid;
 
 
 	// RAM
@@ -34,7 +34,7 @@
 `default_nettype none
 
 module uart_wb #(
-	parameter integer FIFO_DEPTH = 16,
+	parameter integer FIFO_DEPTH = 16,	// Up to 2048
 	parameter integer DIV_WIDTH = 8,
 	parameter integer DW = 16,
 	parameter integer IRDA = 0
@@ -43,6 +43,9 @@ module uart_wb #(
 	output wire uart_tx,
 	input  wire uart_rx,
 
+	// IRQ (level)
+	output reg  irq,
+
 	// Bus interface
 	input  wire [1:0] bus_addr,
 	input  wire [DW-1:0] bus_wdata,
@@ -56,6 +59,11 @@ module uart_wb #(
 	input  wire rst
 );
 
+	localparam integer LW = $clog2(FIFO_DEPTH) + 1;
+
+	// Registers 2 / 3 don't fit a narrower bus, they need DW >= 32
+	localparam HAS_IRQ = (DW >= 32) ? 1'b1 : 1'b0;
+
 	// Signals
 	// -------
 
@@ -87,9 +95,22 @@ module uart_wb #(
 	wire [ 7:0] uart_rx_data;
 	wire        uart_rx_stb;
 
+	// Levels
+	wire [LW-1:0] urf_level;
+	wire          urf_afull;
+	wire [LW-1:0] utf_level;
+	wire          utf_aempty;
+
 	// CSR
 	reg  [DIV_WIDTH-1:0] uart_div;
 
+	reg  [11:0] irq_rx_thr;
+	reg  [11:0] irq_tx_thr;
+	reg         irq_rx_ena;
+	reg         irq_tx_ena;
+	wire        irq_rx;
+	wire        irq_tx;
+
 	// Bus IF
 	wire        ub_rdata_rst;
 	reg  [31:0] ub_rdata;
@@ -97,7 +118,10 @@ module uart_wb #(
 	reg         ub_rd_ctrl;
 	reg         ub_wr_data;
 	reg         ub_wr_div;
+	reg         ub_wr_irq;
 	reg         ub_ack;
+	wire [31:0] ub_rd_mux;
+	wire [31:0] ub_wdata;
 
 
 	// TX Core
@@ -144,6 +168,11 @@ module uart_wb #(
 		.rd_data(utf_rdata),
 		.rd_ena(utf_rden),
 		.rd_empty(utf_empty),
+		.level(utf_level),
+		.afull_thr({LW{1'b1}}),
+		.wr_afull(),
+		.aempty_thr(irq_tx_thr[LW-1:0]),
+		.rd_aempty(utf_aempty),
 		.clk(clk),
 		.rst(rst)
 	);
@@ -198,6 +227,11 @@ module uart_wb #(
 		.rd_data(urf_rdata),
 		.rd_ena(urf_rden),
 		.rd_empty(urf_empty),
+		.level(urf_level),
+		.afull_thr(irq_rx_thr[LW-1:0]),
+		.wr_afull(urf_afull),
+		.aempty_thr({LW{1'b0}}),
+		.rd_aempty(),
 		.clk(clk),
 		.rst(rst)
 	);
@@ -214,8 +248,34 @@ module uart_wb #(
 			urf_overflow <= (urf_overflow & ~urf_overflow_clr) | (uart_rx_stb & urf_full);
 
 
+	// Levels / IRQ
+	// ------------
+
+	// RX: level reached (or data lost), TX: drained down to the threshold
+	// (thresholds are compared by the FIFOs, must be <= FIFO_DEPTH)
+	assign irq_rx = urf_afull | urf_overflow;
+	assign irq_tx = utf_aempty;
+
+	always @(posedge clk or posedge rst)
+		if (rst)
+			irq <= 1'b0;
+		else
+			irq <= (irq_rx_ena & irq_rx) | (irq_tx_ena & irq_tx);
+
+
 	// Bus interface
 	// -------------
+	//
+	// 0 : [31] RX empty, [7:0] RX data (read) / TX data (write)
+	// 1 : [31] RX empty, [30] RX overflow, [29] TX empty, [28] TX full,
+	//     [DIV_WIDTH-1:0] divisor (bit time = div + 2 clocks)
+	// 2 : [31] RX IRQ enable, [30] TX IRQ enable, [29] RX IRQ, [28] TX IRQ (RO),
+	//     [27:16] TX threshold (IRQ when level <= thr),
+	//     [11:0] RX threshold (IRQ when level >= thr or overflow)
+	// 3 : [27:16] TX level, [11:0] RX level (RO)
+	//
+	// With DW < 32, registers 2 and 3 read as 0 and ignore writes, so the
+	// IRQs stay disabled.
 
 	always @(posedge clk)
 		if (ub_ack) begin
@@ -223,24 +283,33 @@ module uart_wb #(
 			ub_rd_ctrl <= 1'b0;
 			ub_wr_data <= 1'b0;
 			ub_wr_div  <= 1'b0;
+			ub_wr_irq  <= 1'b0;
 		end else begin
 			ub_rd_data <= ~bus_we & bus_cyc & (bus_addr == 2'b00);
 			ub_rd_ctrl <= ~bus_we & bus_cyc & (bus_addr == 2'b01);
 			ub_wr_data <=  bus_we & bus_cyc & (bus_addr == 2'b00) & ~utf_full;
 			ub_wr_div  <=  bus_we & bus_cyc & (bus_addr == 2'b01);
+			ub_wr_irq  <=  bus_we & bus_cyc & (bus_addr == 2'b10) & HAS_IRQ;
 		end
 
 	always @(posedge clk)
 		if (ub_ack)
 			ub_ack <= 1'b0;
 		else
-			ub_ack <= bus_cyc & (~bus_we | (bus_addr == 2'b01) | ~utf_full);
+			ub_ack <= bus_cyc & (~bus_we | (bus_addr != 2'b00) | ~utf_full);
 
 	assign ub_rdata_rst = ub_ack | bus_we | ~bus_cyc;
 
+	// Registers 2 (IRQ) and 3 (levels) have a fixed 32 bits layout
+	assign ub_rd_mux = bus_addr[0] ?
+		{ 4'h0, 12'h000 | utf_level, 4'h0, 12'h000 | urf_level } :
+		{ irq_rx_ena, irq_tx_ena, irq_rx, irq_tx, irq_tx_thr, 4'h0, irq_rx_thr };
+
 	always @(posedge clk)
 		if (ub_rdata_rst)
 			ub_rdata <= { DW{1'b0} };
+		else if (bus_addr[1])
+			ub_rdata <= HAS_IRQ ? ub_rd_mux : 32'h00000000;
 		else
 			ub_rdata <= bus_addr[0] ?
 				{ urf_empty, urf_overflow, utf_empty, utf_full, { (DW-DIV_WIDTH-4){1'b0} }, uart_div } :
@@ -250,6 +319,21 @@ module uart_wb #(
 		if (ub_wr_div)
 			uart_div <= bus_wdata[DIV_WIDTH-1:0];
 
+	assign ub_wdata = bus_wdata;
+
+	always @(posedge clk or posedge rst)
+		if (rst) begin
+			irq_rx_ena <= 1'b0;
+			irq_tx_ena <= 1'b0;
+			irq_rx_thr <= 12'h001;
+			irq_tx_thr <= 12'h000;
+		end else if (ub_wr_irq) begin
+			irq_rx_ena <= ub_wdata[31];
+			irq_tx_ena <= ub_wdata[30];
+			irq_tx_thr <= ub_wdata[27:16];
+			irq_rx_thr <= ub_wdata[11:0];
+		end
+
 	assign utf_wdata = bus_wdata[7:0];
 	assign utf_wren  = ub_wr_data;
 
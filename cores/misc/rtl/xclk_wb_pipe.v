@@ -0,0 +1,286 @@
+/*
+ * xclk_wb_pipe.v
+ *
+ * vim: ts=4 sw=4
+ *
+ * Copyright (C) 2019  Sylvain Munaut <tnt@246tNt.com>
+ * All rights reserved.
+ *
+ * BSD 3-clause, see LICENSE.bsd
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <organization> nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+`default_nettype none
+
+module xclk_wb_pipe #(
+	parameter integer DW = 16,
+	parameter integer AW = 16,
+	parameter integer FIFO_AW = 2,	// Request FIFO depth = 2^FIFO_AW, must be >= 2
+	parameter integer PREFETCH = 0	// Only for slaves with read side-effect free
+)(
+	// Slave bus interface
+	input  wire [AW-1:0] s_addr,
+	input  wire [DW-1:0] s_wdata,
+	output reg  [DW-1:0] s_rdata,
+	input  wire s_cyc,
+	output reg  s_ack,
+	input  wire s_we,
+	input  wire s_clk,
+
+	// Master bus interface
+	output reg  [AW-1:0] m_addr,
+	output reg  [DW-1:0] m_wdata,
+	input  wire [DW-1:0] m_rdata,
+	output reg  m_cyc,
+	input  wire m_ack,
+	output reg  m_we,
+	input  wire m_clk,
+
+	// Reset
+	input  wire rst
+);
+
+	// Writes are pushed in a small request FIFO and acked right away on
+	// the slave side. Reads go through the same FIFO (so they're ordered
+	// with the writes) and only one can be in flight. The response lands
+	// in a one word buffer and with PREFETCH, the next address is read
+	// as soon as a read completes, so sequential reads don't have to wait
+	// for a full round trip.
+
+	localparam integer RW = 1 + AW + DW;
+
+	// Signals
+	// -------
+
+	// Request FIFO
+	reg  [RW-1:0] rf_mem [0:(1<<FIFO_AW)-1];
+
+	reg  [FIFO_AW:0] rf_wp_bin;
+	reg  [FIFO_AW:0] rf_wp_gray;
+	reg  [FIFO_AW:0] rf_rp_gray_s0;
+	reg  [FIFO_AW:0] rf_rp_gray_s1;
+
+	reg  [FIFO_AW:0] rf_rp_bin;
+	reg  [FIFO_AW:0] rf_rp_gray;
+	reg  [FIFO_AW:0] rf_wp_gray_m0;
+	reg  [FIFO_AW:0] rf_wp_gray_m1;
+
+	wire [FIFO_AW:0] rf_wp_bin_nxt;
+	wire [FIFO_AW:0] rf_rp_bin_nxt;
+
+	wire rf_full;
+	wire rf_empty;
+
+	wire rf_push;
+	wire [RW-1:0] rf_wdata;
+	wire rf_pop;
+	wire [RW-1:0] rf_rdata;
+
+	// Slave side
+	wire s_rd;
+	wire s_wr;
+
+	reg  rd_pend;
+	reg  rd_stale;
+	reg  [AW-1:0] rd_addr;
+
+	reg  pf_valid;
+	reg  [AW-1:0] pf_addr;
+	reg  [DW-1:0] pf_data;
+	wire pf_hit;
+
+	wire rd_issue;
+	wire [AW-1:0] rd_issue_addr;
+
+	// Response
+	reg  [DW-1:0] rsp_data;
+	wire rsp_stb_m;
+	wire rsp_stb_s;
+
+
+	// Request FIFO
+	// ------------
+
+	// Write side (slave clock)
+	assign rf_wp_bin_nxt = rf_wp_bin + 1;
+
+	always @(posedge s_clk)
+		if (rf_push)
+			rf_mem[rf_wp_bin[FIFO_AW-1:0]] <= rf_wdata;
+
+	always @(posedge s_clk or posedge rst)
+		if (rst) begin
+			rf_wp_bin  <= 0;
+			rf_wp_gray <= 0;
+		end else if (rf_push) begin
+			rf_wp_bin  <= rf_wp_bin_nxt;
+			rf_wp_gray <= rf_wp_bin_nxt ^ (rf_wp_bin_nxt >> 1);
+		end
+
+	always @(posedge s_clk or posedge rst)
+		if (rst) begin
+			rf_rp_gray_s0 <= 0;
+			rf_rp_gray_s1 <= 0;
+		end else begin
+			rf_rp_gray_s0 <= rf_rp_gray;
+			rf_rp_gray_s1 <= rf_rp_gray_s0;
+		end
+
+	assign rf_full = (rf_wp_gray == { ~rf_rp_gray_s1[FIFO_AW:FIFO_AW-1], rf_rp_gray_s1[FIFO_AW-2:0] });
+
+	// Read side (master clock)
+		// The entry was written a few cycles before the pointer made it
+		// through the synchronizer, so it can be read directly
+	assign rf_rp_bin_nxt = rf_rp_bin + 1;
+	assign rf_rdata = rf_mem[rf_rp_bin[FIFO_AW-1:0]];
+
+	always @(posedge m_clk or posedge rst)
+		if (rst) begin
+			rf_rp_bin  <= 0;
+			rf_rp_gray <= 0;
+		end else if (rf_pop) begin
+			rf_rp_bin  <= rf_rp_bin_nxt;
+			rf_rp_gray <= rf_rp_bin_nxt ^ (rf_rp_bin_nxt >> 1);
+		end
+
+	always @(posedge m_clk or posedge rst)
+		if (rst) begin
+			rf_wp_gray_m0 <= 0;
+			rf_wp_gray_m1 <= 0;
+		end else begin
+			rf_wp_gray_m0 <= rf_wp_gray;
+			rf_wp_gray_m1 <= rf_wp_gray_m0;
+		end
+
+	assign rf_empty = (rf_rp_gray == rf_wp_gray_m1);
+
+
+	// Slave side
+	// ----------
+
+	assign s_wr = s_cyc & ~s_ack &  s_we & ~rf_full;
+	assign s_rd = s_cyc & ~s_ack & ~s_we;
+
+	assign pf_hit = pf_valid & (pf_addr == s_addr);
+
+	// Read request: either the one we need or, after a hit, the next one
+	assign rd_issue =
+		s_rd & ~rf_full & (pf_hit ? (PREFETCH != 0) : ~rd_pend);
+
+	assign rd_issue_addr = pf_hit ? (s_addr + 1) : s_addr;
+
+	// Requests
+	assign rf_push  = s_wr | rd_issue;
+	assign rf_wdata = s_wr ?
+		{ 1'b1, s_addr, s_wdata } :
+		{ 1'b0, rd_issue_addr, { DW{1'b0} } };
+
+	// Read tracking / prefetch buffer
+	always @(posedge s_clk or posedge rst)
+		if (rst) begin
+			rd_pend  <= 1'b0;
+			rd_stale <= 1'b0;
+			pf_valid <= 1'b0;
+		end else begin
+			// Responses always land in the buffer
+			if (rsp_stb_s) begin
+				rd_pend  <= 1'b0;
+				pf_valid <= ~rd_stale;
+			end
+
+			// Wrong read in flight, drop its data once it's back
+			if (s_rd & ~pf_hit & rd_pend & (rd_addr != s_addr))
+				rd_stale <= 1'b1;
+
+			// Consumed, or about to be replaced
+			if (s_rd & (pf_hit | rd_issue))
+				pf_valid <= 1'b0;
+
+			if (rd_issue) begin
+				rd_pend  <= 1'b1;
+				rd_stale <= 1'b0;
+			end
+
+			// Any write invalidates what we read ahead
+			if (s_wr) begin
+				pf_valid <= 1'b0;
+				rd_stale <= rd_pend & ~rsp_stb_s;
+			end
+		end
+
+	always @(posedge s_clk)
+	begin
+		if (rd_issue)
+			rd_addr <= rd_issue_addr;
+
+		if (rsp_stb_s) begin
+			pf_addr <= rd_addr;
+			pf_data <= rsp_data;
+		end
+	end
+
+	// Ack / Read data
+	always @(posedge s_clk or posedge rst)
+		if (rst)
+			s_ack <= 1'b0;
+		else
+			s_ack <= s_wr | (s_rd & pf_hit);
+
+	always @(posedge s_clk)
+		if (s_rd & pf_hit)
+			s_rdata <= pf_data;
+		else
+			s_rdata <= 0;
+
+
+	// Master side
+	// -----------
+
+	assign rf_pop = ~rf_empty & ~m_cyc;
+
+	always @(posedge m_clk or posedge rst)
+		if (rst)
+			m_cyc <= 1'b0;
+		else
+			m_cyc <= (m_cyc & ~m_ack) | rf_pop;
+
+	always @(posedge m_clk)
+		if (rf_pop)
+			{ m_we, m_addr, m_wdata } <= rf_rdata;
+
+	always @(posedge m_clk)
+		if (m_cyc & m_ack & ~m_we)
+			rsp_data <= m_rdata;
+
+	assign rsp_stb_m = m_cyc & m_ack & ~m_we;
+
+	xclk_strobe xclk_rsp (
+		.in_stb(rsp_stb_m),
+		.in_clk(m_clk),
+		.out_stb(rsp_stb_s),
+		.out_clk(s_clk),
+		.rst(rst)
+	);
+
+endmodule // xclk_wb_pipe
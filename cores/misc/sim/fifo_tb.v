@@ -48,6 +48,21 @@ module fifo_tb;
 	wire rd_ena;
 	wire rd_empty;
 
+	wire [2:0] level;
+	wire wr_afull;
+	wire rd_aempty;
+
+	// Standard (non-FWFT) mode DUT
+	wire [7:0] s_wr_data;
+	wire [7:0] s_rd_data;
+	wire s_wr_ena;
+	wire s_wr_full;
+	wire s_rd_ena;
+	wire s_rd_empty;
+	wire [2:0] s_level;
+	wire s_wr_afull;
+	wire s_rd_aempty;
+
 	// Setup recording
 	initial begin
 		$dumpfile("fifo_tb.vcd");
@@ -75,6 +90,31 @@ module fifo_tb;
 		.rd_data(rd_data),
 		.rd_ena(rd_ena),
 		.rd_empty(rd_empty),
+		.level(level),
+		.afull_thr(3'd3),
+		.wr_afull(wr_afull),
+		.aempty_thr(3'd1),
+		.rd_aempty(rd_aempty),
+		.clk(clk),
+		.rst(rst)
+	);
+
+	fifo_sync_ram #(
+		.DEPTH(4),
+		.WIDTH(8),
+		.FWFT(0)
+	) dut_std_I (
+		.wr_data(s_wr_data),
+		.wr_ena(s_wr_ena),
+		.wr_full(s_wr_full),
+		.rd_data(s_rd_data),
+		.rd_ena(s_rd_ena),
+		.rd_empty(s_rd_empty),
+		.level(s_level),
+		.afull_thr(3'd3),
+		.wr_afull(s_wr_afull),
+		.aempty_thr(3'd1),
+		.rd_aempty(s_rd_aempty),
 		.clk(clk),
 		.rst(rst)
 	);
@@ -99,4 +139,72 @@ module fifo_tb;
 	assign wr_ena = rnd_wr & ~wr_full;
 	assign rd_ena = rnd_rd & ~rd_empty;
 
+	// Checks (FWFT): data order, level and threshold flags
+	reg [7:0] exp;
+	reg [2:0] exp_level;
+
+	always @(posedge clk)
+		if (rst) begin
+			exp <= 8'h00;
+			exp_level <= 3'd0;
+		end else begin
+			if (rd_ena) begin
+				if (rd_data !== exp)
+					$display("ERROR: FWFT read %02x, expected %02x", rd_data, exp);
+				exp <= exp + 1;
+			end
+
+			if (level !== exp_level)
+				$display("ERROR: FWFT level %d, expected %d", level, exp_level);
+			if (wr_afull !== (exp_level >= 3))
+				$display("ERROR: FWFT almost full flag at level %d", exp_level);
+			if (rd_aempty !== (exp_level <= 1))
+				$display("ERROR: FWFT almost empty flag at level %d", exp_level);
+
+			exp_level <= exp_level + wr_ena - rd_ena;
+		end
+
+	// Checks (Standard): data comes the cycle after rd_ena, level and
+	// threshold flags follow the accepted reads / writes like in FWFT
+	reg [7:0] s_cnt;
+	reg [7:0] s_exp;
+	reg [2:0] s_exp_level;
+	reg s_rnd_rd;
+	reg s_rnd_wr;
+	reg s_rd_pend;
+
+	always @(posedge clk)
+		if (rst) begin
+			s_cnt <= 8'h00;
+			s_exp <= 8'h00;
+			s_exp_level <= 3'd0;
+			s_rnd_rd <= 1'b0;
+			s_rnd_wr <= 1'b0;
+			s_rd_pend <= 1'b0;
+		end else begin
+			s_cnt <= s_cnt + s_wr_ena;
+			s_rnd_rd <= $random;
+			s_rnd_wr <= $random;
+			s_rd_pend <= s_rd_ena;
+
+			if (s_rd_pend) begin
+				if (s_rd_data !== s_exp)
+					$display("ERROR: Standard read %02x, expected %02x", s_rd_data, s_exp);
+				s_exp <= s_exp + 1;
+			end
+
+			if (s_level !== s_exp_level)
+				$display("ERROR: Standard level %d, expected %d", s_level, s_exp_level);
+			if (s_wr_afull !== (s_exp_level >= 3))
+				$display("ERROR: Standard almost full flag at level %d", s_exp_level);
+			if (s_rd_aempty !== (s_exp_level <= 1))
+				$display("ERROR: Standard almost empty flag at level %d", s_exp_level);
+
+			s_exp_level <= s_exp_level + s_wr_ena - s_rd_ena;
+		end
+
+	assign s_wr_data = s_wr_ena ? s_cnt : 8'hxx;
+	assign s_wr_ena = s_rnd_wr & ~s_wr_full;
+	assign s_rd_ena = s_rnd_rd & ~s_rd_empty;
+
 endmodule // fifo_tb
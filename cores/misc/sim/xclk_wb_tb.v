@@ -0,0 +1,280 @@
+/*
+ * xclk_wb_tb.v
+ *
+ * vim: ts=4 sw=4
+ *
+ * Copyright (C) 2019  Sylvain Munaut <tnt@246tNt.com>
+ * All rights reserved.
+ *
+ * BSD 3-clause, see LICENSE.bsd
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the <organization> nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+`default_nettype none
+`timescale 1ns / 100ps
+
+module xclk_wb_tb;
+
+	// Params
+	localparam integer N = 64;		// Transactions per pass
+	localparam real M_PERIOD = 20.833;	// 48 MHz master (peripheral) side
+
+	// Signals
+	reg rst = 1'b1;
+	reg s_clk = 1'b0;
+	reg m_clk = 1'b0;
+
+	real s_half = 10.4;
+
+	// Slave side bus (shared, cyc selects the DUT)
+	reg  [15:0] s_addr;
+	reg  [31:0] s_wdata;
+	reg  s_we;
+	reg  s_cyc;
+	reg  [1:0] s_dut;
+
+	wire [31:0] s_rdata_dut [0:2];
+	wire [ 2:0] s_ack_dut;
+
+	wire [31:0] s_rdata = s_rdata_dut[s_dut];
+	wire s_ack = s_ack_dut[s_dut];
+
+	// Master side buses
+	wire [15:0] m_addr  [0:2];
+	wire [31:0] m_wdata [0:2];
+	wire [31:0] m_rdata [0:2];
+	wire [ 2:0] m_cyc;
+	wire [ 2:0] m_ack;
+	wire [ 2:0] m_we;
+
+	// Setup recording
+	initial begin
+		$dumpfile("xclk_wb_tb.vcd");
+		$dumpvars(0,xclk_wb_tb);
+	end
+
+	// Clocks
+	always #(s_half) s_clk = !s_clk;
+	always #(M_PERIOD / 2) m_clk = !m_clk;
+
+	// DUTs
+	xclk_wb #(
+		.DW(32),
+		.AW(16)
+	) dut_ref_I (
+		.s_addr(s_addr),
+		.s_wdata(s_wdata),
+		.s_rdata(s_rdata_dut[0]),
+		.s_cyc(s_cyc & (s_dut == 0)),
+		.s_ack(s_ack_dut[0]),
+		.s_we(s_we),
+		.s_clk(s_clk),
+		.m_addr(m_addr[0]),
+		.m_wdata(m_wdata[0]),
+		.m_rdata(m_rdata[0]),
+		.m_cyc(m_cyc[0]),
+		.m_ack(m_ack[0]),
+		.m_we(m_we[0]),
+		.m_clk(m_clk),
+		.rst(rst)
+	);
+
+	xclk_wb_pipe #(
+		.DW(32),
+		.AW(16),
+		.PREFETCH(0)
+	) dut_pipe_I (
+		.s_addr(s_addr),
+		.s_wdata(s_wdata),
+		.s_rdata(s_rdata_dut[1]),
+		.s_cyc(s_cyc & (s_dut == 1)),
+		.s_ack(s_ack_dut[1]),
+		.s_we(s_we),
+		.s_clk(s_clk),
+		.m_addr(m_addr[1]),
+		.m_wdata(m_wdata[1]),
+		.m_rdata(m_rdata[1]),
+		.m_cyc(m_cyc[1]),
+		.m_ack(m_ack[1]),
+		.m_we(m_we[1]),
+		.m_clk(m_clk),
+		.rst(rst)
+	);
+
+	xclk_wb_pipe #(
+		.DW(32),
+		.AW(16),
+		.PREFETCH(1)
+	) dut_pf_I (
+		.s_addr(s_addr),
+		.s_wdata(s_wdata),
+		.s_rdata(s_rdata_dut[2]),
+		.s_cyc(s_cyc & (s_dut == 2)),
+		.s_ack(s_ack_dut[2]),
+		.s_we(s_we),
+		.s_clk(s_clk),
+		.m_addr(m_addr[2]),
+		.m_wdata(m_wdata[2]),
+		.m_rdata(m_rdata[2]),
+		.m_cyc(m_cyc[2]),
+		.m_ack(m_ack[2]),
+		.m_we(m_we[2]),
+		.m_clk(m_clk),
+		.rst(rst)
+	);
+
+	// Memory slaves (registered ack, zero data when idle)
+	genvar i;
+	for (i=0; i<3; i=i+1) begin : slave
+		reg [31:0] mem [0:255];
+		reg [31:0] rdata;
+		reg ack;
+
+		always @(posedge m_clk)
+		begin
+			ack   <= m_cyc[i] & ~ack;
+			rdata <= (m_cyc[i] & ~ack & ~m_we[i]) ? mem[m_addr[i][7:0]] : 32'h00000000;
+			if (m_cyc[i] & ~ack & m_we[i])
+				mem[m_addr[i][7:0]] <= m_wdata[i];
+		end
+
+		assign m_ack[i] = ack;
+		assign m_rdata[i] = rdata;
+	end
+
+	// Bus master
+	integer errors = 0;
+	reg [31:0] pat;		// Changes for each pass so stale data is caught
+
+	task bus_write;
+		input [15:0] addr;
+		input [31:0] data;
+		begin
+			s_addr  <= addr;
+			s_wdata <= data;
+			s_we    <= 1'b1;
+			s_cyc   <= 1'b1;
+			@(posedge s_clk);
+			while (~s_ack)
+				@(posedge s_clk);
+			s_cyc   <= 1'b0;
+		end
+	endtask
+
+	task bus_read;
+		input  [15:0] addr;
+		output [31:0] data;
+		begin
+			s_addr  <= addr;
+			s_we    <= 1'b0;
+			s_cyc   <= 1'b1;
+			@(posedge s_clk);
+			while (~s_ack)
+				@(posedge s_clk);
+			data = s_rdata;
+			s_cyc   <= 1'b0;
+		end
+	endtask
+
+	// Test passes
+	task run_pass;
+		input integer dut;
+		input integer kind;	// 0 = writes, 1 = sequential reads, 2 = write/read
+		real t0, t1;
+		integer j;
+		reg [31:0] d;
+		begin
+			s_dut = dut;
+			@(posedge s_clk);
+			t0 = $realtime;
+
+			for (j=0; j<N; j=j+1)
+				case (kind)
+				0: bus_write(j, { dut[7:0], 8'h00, j[15:0] } ^ pat);
+				1: begin
+					bus_read(j, d);
+					if (d !== ({ dut[7:0], 8'h00, j[15:0] } ^ pat)) begin
+						$display("ERROR: DUT %0d, addr %0d, got %08x", dut, j, d);
+						errors = errors + 1;
+					end
+				end
+				2: begin
+					bus_write(j, ~j);
+					bus_read(j, d);
+					if (d !== ~j) begin
+						$display("ERROR: DUT %0d, addr %0d, got %08x", dut, j, d);
+						errors = errors + 1;
+					end
+				end
+				endcase
+
+			t1 = $realtime;
+
+			$display("  %s\t%s\t%7.2f Mtransfers/s",
+				(dut == 0) ? "xclk_wb" : ((dut == 1) ? "pipe   " : "pipe+pf"),
+				(kind == 0) ? "write     " : ((kind == 1) ? "seq read  " : "write/read"),
+				((kind == 2) ? 2*N : N) * 1000.0 / (t1 - t0));
+		end
+	endtask
+
+	task run_ratio;
+		input real s_period;
+		integer dut, kind;
+		begin
+			// Reset with the new clock
+			rst = 1'b1;
+			s_cyc = 1'b0;
+			s_half = s_period / 2;
+			pat = $rtoi(s_period * 1000.0) << 8;
+			#200 rst = 1'b0;
+			#200;
+
+			$display("Slave clock %6.2f MHz, master clock %6.2f MHz",
+				1000.0 / s_period, 1000.0 / M_PERIOD);
+
+			for (dut=0; dut<3; dut=dut+1)
+				for (kind=0; kind<3; kind=kind+1)
+					run_pass(dut, kind);
+		end
+	endtask
+
+	initial begin
+		s_cyc = 1'b0;
+		s_we  = 1'b0;
+		s_dut = 0;
+
+		run_ratio(41.667);	//  24 MHz
+		run_ratio(20.833);	//  48 MHz
+		run_ratio(12.5);	//  80 MHz
+		run_ratio(10.417);	//  96 MHz
+
+		if (errors)
+			$display("FAILED: %0d errors", errors);
+		else
+			$display("PASSED");
+
+		$finish;
+	end
+
+endmodule // xclk_wb_tb
@@ -7,6 +7,7 @@ RTL_SRCS_usb := $(addprefix rtl/, \
 	usb_crc.v \
 	usb_ep_buf.v \
 	usb_ep_status.v \
+	usb_ep_status_dp.v \
 	usb_phy.v \
 	usb_rx_ll.v \
 	usb_rx_pkt.v \
@@ -21,7 +22,9 @@ PREREQ_usb := \
 	$(BUILD_TMP)/usb_ep_status.hex
 
 TESTBENCHES_usb := \
+	usb_crc_tb \
 	usb_ep_buf_tb \
+	usb_rx_tb \
 	usb_tb \
 	usb_tx_tb
 
@@ -29,9 +29,10 @@ module usb #(
 	parameter         TARGET = "ICE40",
 	parameter integer EPDW = 16,
 	parameter integer EVT_DEPTH = 0,
+	parameter integer EP_AW = 11,	// EP buffers size (bytes, log2), each for RX/TX
 
 	/* Auto-set */
-	parameter integer EPAW = 11 - $clog2(EPDW / 8)
+	parameter integer EPAW = EP_AW - $clog2(EPDW / 8)
 )(
 	// Pads
 	inout  wire pad_dp,
@@ -122,11 +123,11 @@ module usb #(
 	wire rxpkt_data_stb;
 
 	// EP Buffers
-	wire [10:0] buf_tx_addr_0;
+	wire [EP_AW-1:0] buf_tx_addr_0;
 	wire [ 7:0] buf_tx_data_1;
 	wire buf_tx_rden_0;
 
-	wire [10:0] buf_rx_addr_0;
+	wire [EP_AW-1:0] buf_rx_addr_0;
 	wire [ 7:0] buf_rx_data_0;
 	wire buf_rx_wren_0;
 
@@ -138,11 +139,8 @@ module usb #(
 	wire [15:0] eps_wrdata_0;
 	wire [15:0] eps_rddata_3;
 
-	wire eps_bus_ready;
-	reg  eps_bus_read;
-	wire eps_bus_zero;
-	reg  eps_bus_write;
 	wire [15:0] eps_bus_dout;
+	wire eps_bus_ack;
 
 	// Config / Status registers
 	reg  cr_pu_ena;
@@ -162,12 +160,6 @@ module usb #(
 
 	reg  cr_bus_we;
 
-	reg  eps_bus_req;
-	wire eps_bus_clear;
-	reg  eps_bus_ack_wait;
-	wire eps_bus_req_ok;
-	reg  [2:0] eps_bus_req_ok_dly;
-
 	wire [15:0] evt_rd_data;
 	wire evt_rd_rdy;
 	reg  evt_rd_ack;
@@ -296,7 +288,9 @@ module usb #(
 	// Transaction control
 	// -------------------
 
-	usb_trans trans_I (
+	usb_trans #(
+		.BUF_AW(EP_AW)
+	) trans_I (
 		.txpkt_start(txpkt_start),
 		.txpkt_done(txpkt_done),
 		.txpkt_pid(txpkt_pid),
@@ -346,7 +340,8 @@ module usb #(
 	usb_ep_buf #(
 		.TARGET(TARGET),
 		.RWIDTH(8),
-		.WWIDTH(EPDW)
+		.WWIDTH(EPDW),
+		.AWIDTH(EP_AW)
 	) tx_buf_I (
 		.rd_addr_0(buf_tx_addr_0),
 		.rd_data_1(buf_tx_data_1),
@@ -361,7 +356,8 @@ module usb #(
 	usb_ep_buf #(
 		.TARGET(TARGET),
 		.RWIDTH(EPDW),
-		.WWIDTH(8)
+		.WWIDTH(8),
+		.AWIDTH(EP_AW)
 	) rx_buf_I (
 		.rd_addr_0(ep_rx_addr_0),
 		.rd_data_1(ep_rx_data_1),
@@ -377,23 +373,111 @@ module usb #(
 	// EP Status / Buffer Descriptors
 	// ------------------------------
 
-	usb_ep_status ep_status_I (
-		.p_addr_0(eps_addr_0),
-		.p_read_0(eps_read_0),
-		.p_zero_0(eps_zero_0),
-		.p_write_0(eps_write_0),
-		.p_din_0(eps_wrdata_0),
-		.p_dout_3(eps_rddata_3),
-		.s_addr_0(bus_addr[7:0]),
-		.s_read_0(eps_bus_ready),
-		.s_zero_0(eps_bus_zero),
-		.s_write_0(eps_bus_write),
-		.s_din_0(bus_din),
-		.s_dout_3(eps_bus_dout),
-		.s_ready_0(eps_bus_ready),
-		.clk(clk),
-		.rst(rst)
-	);
+	generate
+		if (TARGET == "ECP5") begin
+			// True-dual-port RAM available, the bus gets its own port and
+			// never has to wait for the microcode engine
+			wire eps_bus_req;
+			wire eps_bus_read;
+			wire eps_bus_write;
+			reg  eps_bus_ack_i;
+
+			usb_ep_status_dp ep_status_I (
+				.p_addr_0(eps_addr_0),
+				.p_read_0(eps_read_0),
+				.p_zero_0(eps_zero_0),
+				.p_write_0(eps_write_0),
+				.p_din_0(eps_wrdata_0),
+				.p_dout_3(eps_rddata_3),
+				.s_addr_0(bus_addr[7:0]),
+				.s_read_0(eps_bus_read),
+				.s_zero_0(1'b0),
+				.s_write_0(eps_bus_write),
+				.s_din_0(bus_din),
+				.s_dout_1(eps_bus_dout),
+				.clk(clk),
+				.rst(rst)
+			);
+
+			// Request lines, directly from the bus
+			assign eps_bus_req   = bus_cyc & bus_addr[11] & ~eps_bus_ack_i;
+			assign eps_bus_read  = eps_bus_req & ~bus_we;
+			assign eps_bus_write = eps_bus_req &  bus_we;
+
+			// Fixed single cycle latency for both read and writes
+			always @(posedge clk or posedge rst)
+				if (rst)
+					eps_bus_ack_i <= 1'b0;
+				else
+					eps_bus_ack_i <= eps_bus_req;
+
+			assign eps_bus_ack = eps_bus_ack_i;
+
+		end else begin
+			// Single RAM port shared with the microcode engine
+			wire eps_bus_ready;
+			reg  eps_bus_read;
+			wire eps_bus_zero;
+			reg  eps_bus_write;
+
+			reg  eps_bus_req;
+			wire eps_bus_clear;
+			reg  eps_bus_ack_wait;
+			wire eps_bus_req_ok;
+			reg  [2:0] eps_bus_req_ok_dly;
+
+			usb_ep_status ep_status_I (
+				.p_addr_0(eps_addr_0),
+				.p_read_0(eps_read_0),
+				.p_zero_0(eps_zero_0),
+				.p_write_0(eps_write_0),
+				.p_din_0(eps_wrdata_0),
+				.p_dout_3(eps_rddata_3),
+				.s_addr_0(bus_addr[7:0]),
+				.s_read_0(eps_bus_ready),
+				.s_zero_0(eps_bus_zero),
+				.s_write_0(eps_bus_write),
+				.s_din_0(bus_din),
+				.s_dout_3(eps_bus_dout),
+				.s_ready_0(eps_bus_ready),
+				.clk(clk),
+				.rst(rst)
+			);
+
+			// Request lines for EP Status access
+			always @(posedge clk)
+				if (eps_bus_clear) begin
+					eps_bus_read  <= 1'b0;
+					eps_bus_write <= 1'b0;
+					eps_bus_req   <= 1'b0;
+				end else begin
+					eps_bus_read  <=  bus_addr[11] & ~bus_we;
+					eps_bus_write <=  bus_addr[11] &  bus_we;
+					eps_bus_req   <=  bus_addr[11];
+				end
+
+			assign eps_bus_zero = ~eps_bus_read;
+
+			// EPS Clear
+			assign eps_bus_clear = ~bus_cyc | eps_bus_ack_wait | (eps_bus_req & eps_bus_ready);
+
+			// Track when request are accepted by the RAM
+			assign eps_bus_req_ok = (eps_bus_req & eps_bus_ready);
+
+			always @(posedge clk)
+				eps_bus_req_ok_dly <= { eps_bus_req_ok_dly[1:0], eps_bus_req_ok & ~bus_we };
+
+			// ACK wait state tracking
+			always @(posedge clk or posedge rst)
+				if (rst)
+					eps_bus_ack_wait <= 1'b0;
+				else
+					eps_bus_ack_wait <= ((eps_bus_ack_wait & ~bus_we) | eps_bus_req_ok) & ~eps_bus_req_ok_dly[2];
+
+			assign eps_bus_ack = eps_bus_ack_wait & (bus_we | eps_bus_req_ok_dly[2]);
+
+		end
+	endgenerate
 
 
 	// CSR & Bus Interface
@@ -454,38 +538,8 @@ module usb #(
 			cr_addr    <= bus_din[6:0];
 		end
 
-	// Request lines for EP Status access
-	always @(posedge clk)
-		if (eps_bus_clear) begin
-			eps_bus_read  <= 1'b0;
-			eps_bus_write <= 1'b0;
-			eps_bus_req   <= 1'b0;
-		end else begin
-			eps_bus_read  <=  bus_addr[11] & ~bus_we;
-			eps_bus_write <=  bus_addr[11] &  bus_we;
-			eps_bus_req   <=  bus_addr[11];
-		end
-
-	assign eps_bus_zero = ~eps_bus_read;
-
-	// EPS Clear
-	assign eps_bus_clear = ~bus_cyc | eps_bus_ack_wait | (eps_bus_req & eps_bus_ready);
-
-	// Track when request are accepted by the RAM
-	assign eps_bus_req_ok = (eps_bus_req & eps_bus_ready);
-
-	always @(posedge clk)
-		eps_bus_req_ok_dly <= { eps_bus_req_ok_dly[1:0], eps_bus_req_ok & ~bus_we };
-
-	// ACK wait state tracking
-	always @(posedge clk or posedge rst)
-		if (rst)
-			eps_bus_ack_wait <= 1'b0;
-		else
-			eps_bus_ack_wait <= ((eps_bus_ack_wait & ~bus_we) | eps_bus_req_ok) & ~eps_bus_req_ok_dly[2];
-
 	// Bus Ack
-	assign bus_ack = csr_bus_ack | (eps_bus_ack_wait & (bus_we | eps_bus_req_ok_dly[2]));
+	assign bus_ack = csr_bus_ack | eps_bus_ack;
 
 	// Output is simply the OR of all local units since we force them to zero if
 	// they're not accessed
@@ -28,10 +28,11 @@
 module usb_crc #(
 	parameter integer WIDTH = 5,
 	parameter POLY  = 5'b00011,
-	parameter MATCH = 5'b00000
+	parameter MATCH = 5'b00000,
+	parameter integer DW = 1	// Bits per cycle (LSB first)
 )(
 	// Input
-	input  wire in_bit,
+	input  wire [DW-1:0] in_data,
 	input  wire in_first,
 	input  wire in_valid,
 
@@ -46,12 +47,23 @@ module usb_crc #(
 
 	reg  [WIDTH-1:0] state;
 	wire [WIDTH-1:0] state_fb_mux;
-	wire [WIDTH-1:0] state_upd_mux;
-	wire [WIDTH-1:0] state_nxt;
+	reg  [WIDTH-1:0] state_nxt;
 
-	assign state_fb_mux  = state & { WIDTH{~in_first} };
-	assign state_upd_mux = (state_fb_mux[WIDTH-1] == in_bit) ? POLY : 0;
-	assign state_nxt = { state_fb_mux[WIDTH-2:0], 1'b1 } ^ state_upd_mux;
+	// Single bit update
+	function [WIDTH-1:0] crc_step(input [WIDTH-1:0] cur, input b);
+		crc_step = { cur[WIDTH-2:0], 1'b1 } ^ ((cur[WIDTH-1] == b) ? POLY : 0);
+	endfunction
+
+	assign state_fb_mux = state & { WIDTH{~in_first} };
+
+	// Unroll for all the input bits
+	always @(*)
+	begin : upd
+		integer i;
+		state_nxt = state_fb_mux;
+		for (i=0; i<DW; i=i+1)
+			state_nxt = crc_step(state_nxt, in_data[i]);
+	end
 
 	always @(posedge clk)
 		if (in_valid)
@@ -289,53 +289,72 @@ module usb_ep_buf #(
 
 `else
 
-	reg [31:0] ram[0:512];
-	reg [31:0] ram_rd;
-	reg [1:0] rds;
-	reg [7:0] rdm;
-
-	always @(posedge rd_clk)
-	begin
-		if (rd_en_0) begin
-			if (RWIDTH == 32)
-				ram_rd <= ram[rd_addr_0];
-			else if (RWIDTH == 8)
-				ram_rd <= ram[rd_addr_0[ARW-1:2]];
-
-			rds <= rd_addr_0[1:0];
+	// Byte-lane storage
+	// -----------------
+	//
+	// The memory is split into byte lanes, each one being a plain 8 bit wide
+	// simple-dual-port RAM. The narrow port accesses one (or a few) lanes
+	// and the wide port all of them at once. Since each lane has a single
+	// width, it gets inferred optimally (on ECP5, one DP16KD in 2048x9 mode
+	// per lane), and increasing AWIDTH is free until the lanes are full
+	// (i.e. 8k with a 32 bits port, 16k with a 64 bits one).
+
+	localparam integer NL  = ((RWIDTH > WWIDTH) ? RWIDTH : WWIDTH) / 8;
+	localparam integer LL  = $clog2(NL);
+	localparam integer RL  = RWIDTH / 8;
+	localparam integer WL  = WWIDTH / 8;
+	localparam integer ARR = AWIDTH - LL;
+
+	wire [ARR-1:0] ram_raddr;
+	wire [ARR-1:0] ram_waddr;
+	wire [NL-1:0] ram_we;
+	wire [(8*NL)-1:0] ram_wdata;
+	wire [(8*NL)-1:0] ram_rdata;
+
+	// Row address
+	assign ram_raddr = rd_addr_0[ARW-1:ARW-ARR];
+	assign ram_waddr = wr_addr_0[AWW-1:AWW-ARR];
+
+	genvar i;
+	generate
+		// Lanes
+		for (i=0; i<NL; i=i+1)
+		begin : lane
+			reg [7:0] mem[0:(1<<ARR)-1];
+			reg [7:0] mem_rd;
+
+			always @(posedge wr_clk)
+				if (ram_we[i])
+					mem[ram_waddr] <= ram_wdata[i*8+:8];
+
+			always @(posedge rd_clk)
+				if (rd_en_0)
+					mem_rd <= mem[ram_raddr];
+
+			assign ram_rdata[i*8+:8] = mem_rd;
+
+			// Write lane select and data mapping
+			if (WL == NL)
+				assign ram_we[i] = wr_en_0;
+			else
+				assign ram_we[i] = wr_en_0 & (wr_addr_0[LL-$clog2(WL)-1:0] == (i / WL));
+
+			assign ram_wdata[i*8+:8] = wr_data_0[(i % WL)*8+:8];
 		end
-	end
 
-	always @(*)
-		case (rds)
-			2'b00: rdm <= ram_rd[ 7: 0];
-			2'b01: rdm <= ram_rd[15: 8];
-			2'b10: rdm <= ram_rd[23:16];
-			2'b11: rdm <= ram_rd[31:24];
-		endcase
-
-	assign rd_data_1 = (RWIDTH == 32) ? ram_rd : rdm;
-
-	always @(posedge wr_clk)
-	begin
-		if (wr_en_0) begin
-			if (WWIDTH == 32) begin
-				ram[wr_addr_0] <= wr_data_0;
-			end else if (WWIDTH == 8) begin
-				if (wr_addr_0[1:0] == 2'b00)
-					ram[wr_addr_0[AWW-1:2]][ 7: 0] <= wr_data_0;
-
-				if (wr_addr_0[1:0] == 2'b01)
-					ram[wr_addr_0[AWW-1:2]][15: 8] <= wr_data_0;
-
-				if (wr_addr_0[1:0] == 2'b10)
-					ram[wr_addr_0[AWW-1:2]][23:16] <= wr_data_0;
-
-				if (wr_addr_0[1:0] == 2'b11)
-					ram[wr_addr_0[AWW-1:2]][31:24] <= wr_data_0;
-			end
+		// Read lane select
+		if (RL == NL) begin
+			assign rd_data_1 = ram_rdata;
+		end else begin
+			reg [LL-$clog2(RL)-1:0] rd_sel;
+
+			always @(posedge rd_clk)
+				if (rd_en_0)
+					rd_sel <= rd_addr_0[LL-$clog2(RL)-1:0];
+
+			assign rd_data_1 = ram_rdata[rd_sel*RWIDTH+:RWIDTH];
 		end
-	end
+	endgenerate
 
 `endif
 
@@ -0,0 +1,140 @@
+/*
+ * usb_ep_status_dp.v
+ *
+ * vim: ts=4 sw=4
+ *
+ * Copyright (C) 2019 Sylvain Munaut
+ * All rights reserved.
+ *
+ * LGPL v3+, see LICENSE.lgpl3
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+`default_nettype none
+
+module usb_ep_status_dp (
+	// Priority port
+	input  wire [ 7:0] p_addr_0,
+	input  wire        p_read_0,
+	input  wire        p_zero_0,
+	input  wire        p_write_0,
+	input  wire [15:0] p_din_0,
+	output reg  [15:0] p_dout_3,
+
+	// Aux R/W port
+	input  wire [ 7:0] s_addr_0,
+	input  wire        s_read_0,
+	input  wire        s_zero_0,
+	input  wire        s_write_0,
+	input  wire [15:0] s_din_0,
+	output wire [15:0] s_dout_1,
+
+	// Clock / Reset
+	input  wire clk,
+	input  wire rst
+);
+	// Signals
+	reg  [ 7:0] p_addr_1;
+	reg  [15:0] p_din_1;
+	reg  p_we_1;
+	reg  p_read_1;
+	reg  p_zero_1;
+
+	wire [15:0] p_dout_2;
+	reg  p_read_2;
+	reg  p_zero_2;
+
+	wire s_we_0;
+	wire [15:0] s_dout_1_ram;
+	reg  s_zero_1;
+
+
+	// Priority port
+	// -------------
+
+	// This port keeps the exact same pipeline as the arbitrated version
+	// so the transaction microcode timing doesn't change.
+
+	// Stage 1 : Address and Write delay
+	always @(posedge clk)
+	begin
+		p_addr_1 <= p_addr_0;
+		p_we_1   <= p_write_0;
+		p_din_1  <= p_din_0;
+		p_read_1 <= p_read_0;
+		p_zero_1 <= p_zero_0;
+	end
+
+	// Stage 2 : Delays
+	always @(posedge clk)
+	begin
+		p_read_2 <= p_read_1 | p_zero_1;
+		p_zero_2 <= p_zero_1;
+	end
+
+	// Stage 3 : Output register
+	always @(posedge clk)
+		if (p_read_2)
+			p_dout_3 <= p_zero_2 ? 16'h0000 : p_dout_2;
+
+
+	// Aux port
+	// --------
+
+	// No arbitration at all, the RAM port is directly driven. On a write
+	// collision to the same word, the priority port wins, just like it would
+	// have if the aux access had been delayed by the arbiter.
+	assign s_we_0 = s_write_0 & ~(p_we_1 & (p_addr_1 == s_addr_0));
+
+	// Zero forcing of the output, like the arbitrated version
+	always @(posedge clk)
+		s_zero_1 <= s_zero_0 | ~s_read_0;
+
+	assign s_dout_1 = s_zero_1 ? 16'h0000 : s_dout_1_ram;
+
+
+	// RAM element
+	// -----------
+
+	// Written to infer a true-dual-port block RAM (DP16KD on ECP5)
+
+	reg [15:0] ram[0:255];
+	reg [15:0] ram_rd_p;
+	reg [15:0] ram_rd_s;
+
+`ifdef SIM
+	initial
+		$readmemh("usb_ep_status.hex", ram);
+`endif
+
+	always @(posedge clk)
+	begin
+		ram_rd_p <= ram[p_addr_1];
+		if (p_we_1)
+			ram[p_addr_1] <= p_din_1;
+	end
+
+	always @(posedge clk)
+	begin
+		ram_rd_s <= ram[s_addr_0];
+		if (s_we_0)
+			ram[s_addr_0] <= s_din_0;
+	end
+
+	assign p_dout_2     = ram_rd_p;
+	assign s_dout_1_ram = ram_rd_s;
+
+endmodule // usb_ep_status_dp
@@ -100,7 +100,7 @@ module usb_rx_pkt (
 	wire bit_last;
 
 	// CRC checking
-	wire crc_in_bit;
+	wire [7:0] crc_in_data;
 	wire crc_in_valid;
 	reg  crc_in_first;
 
@@ -253,9 +253,9 @@ module usb_rx_pkt (
 	// CRC checks
 	// ----------
 
-	// CRC input data
-	assign crc_in_bit   = ll_bit;
-	assign crc_in_valid = llu_bit_stb;
+	// CRC input data (whole bytes)
+	assign crc_in_data  = data_nxt;
+	assign crc_in_valid = llu_byte_stb;
 
 	always @(posedge clk)
 		if (state == ST_PID)
@@ -267,9 +267,10 @@ module usb_rx_pkt (
 	usb_crc #(
 		.WIDTH(5),
 		.POLY(5'b00101),
-		.MATCH(5'b01100)
+		.MATCH(5'b01100),
+		.DW(8)
 	) crc_5_I (
-		.in_bit(crc_in_bit),
+		.in_data(crc_in_data),
 		.in_first(crc_in_first),
 		.in_valid(crc_in_valid),
 		.crc(),
@@ -282,9 +283,10 @@ module usb_rx_pkt (
 	usb_crc #(
 		.WIDTH(16),
 		.POLY(16'h8005),
-		.MATCH(16'h800D)
+		.MATCH(16'h800D),
+		.DW(8)
 	) crc_16_I (
-		.in_bit(crc_in_bit),
+		.in_data(crc_in_data),
 		.in_first(crc_in_first),
 		.in_valid(crc_in_valid),
 		.crc(),
@@ -294,9 +296,9 @@ module usb_rx_pkt (
 	);
 
 	// Capture CRC status at end of each byte
-		// This will be a bit 'late' (i.e. a couple cycles after the last
-		// bit was input), but it's only used when EOP happens, which is
-		// many cycles after that, so this delay is fine
+		// The CRC state is updated the cycle after the byte strobe, so
+		// this is sampled right after. It's only used when EOP happens,
+		// which is many cycles after that, so this delay is fine
 	always @(posedge clk)
 		crc_cap <= llu_byte_stb;
 
@@ -76,12 +76,10 @@ module usb_tx_pkt (
 	reg  [3:0] shift_bit;
 	reg  [7:0] shift_load;
 	reg  [7:0] shift_data;
-	reg  shift_data_crc;
 	wire shift_last_bit;
 	reg  shift_last_byte;
 	wire shift_do_load;
 	wire shift_now;
-	reg  shift_new_bit;
 
 	// Packet length
 	reg [10:0] len;
@@ -89,7 +87,7 @@ module usb_tx_pkt (
 	wire len_dec;
 
 	// CRC
-	wire crc_in_bit;
+	wire [7:0] crc_in_data;
 	reg  crc_in_first;
 	wire crc_in_valid;
 	wire [15:0] crc;
@@ -189,14 +187,8 @@ module usb_tx_pkt (
 
 	// Some flags about the data
 	always @(posedge clk)
-		if (shift_now & shift_do_load) begin
-			shift_data_crc  <= (state == ST_DATA);
+		if (shift_now & shift_do_load)
 			shift_last_byte <= (state == ST_CRC_MSB) | ((state == ST_PID) & pid_is_handshake);
-		end
-
-	// When a fresh new bit is available
-	always @(posedge clk)
-		shift_new_bit <= shift_now;
 
 
 	// Packet length
@@ -218,17 +210,18 @@ module usb_tx_pkt (
 	always @(posedge clk)
 		crc_in_first <= (crc_in_first & ~crc_in_valid) | (state == ST_IDLE);
 
-	// Input all bits once acked
-	assign crc_in_bit   = shift_data[0];
-	assign crc_in_valid = shift_data_crc & shift_new_bit;
+	// Input whole data bytes as they're loaded in the shift register
+	assign crc_in_data  = pkt_data;
+	assign crc_in_valid = shift_do_load & (state == ST_DATA);
 
 	// CRC16 core
 	usb_crc #(
 		.WIDTH(16),
 		.POLY(16'h8005),
-		.MATCH(16'h800D)
+		.MATCH(16'h800D),
+		.DW(8)
 	) crc_16_I (
-		.in_bit(crc_in_bit),
+		.in_data(crc_in_data),
 		.in_first(crc_in_first),
 		.in_valid(crc_in_valid),
 		.crc(crc),
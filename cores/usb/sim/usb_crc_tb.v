@@ -0,0 +1,185 @@
+/*
+ * usb_crc_tb.v
+ *
+ * vim: ts=4 sw=4
+ *
+ * Copyright (C) 2019 Sylvain Munaut
+ * All rights reserved.
+ *
+ * LGPL v3+, see LICENSE.lgpl3
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+`default_nettype none
+`timescale 1ns/100ps
+
+module usb_crc_tb;
+
+	// Signals
+	reg rst = 1;
+	reg clk = 0;
+
+	reg  [7:0] byte_data;
+	reg  byte_first;
+	reg  byte_valid;
+
+	reg  bit_data;
+	reg  bit_first;
+	reg  bit_valid;
+
+	wire [ 4:0] crc5_ser;
+	wire [ 4:0] crc5_par;
+	wire [15:0] crc16_ser;
+	wire [15:0] crc16_par;
+	wire crc16_match_ser;
+	wire crc16_match_par;
+
+	// Setup recording
+	initial begin
+		$dumpfile("usb_crc_tb.vcd");
+		$dumpvars(0,usb_crc_tb);
+	end
+
+	// Clocks
+	always #10 clk = !clk;
+
+	// DUTs: bit serial reference and byte wide
+	usb_crc #(
+		.WIDTH(5),
+		.POLY(5'b00101),
+		.MATCH(5'b01100),
+		.DW(1)
+	) crc5_ser_I (
+		.in_data(bit_data),
+		.in_first(bit_first),
+		.in_valid(bit_valid),
+		.crc(crc5_ser),
+		.crc_match(),
+		.clk(clk),
+		.rst(rst)
+	);
+
+	usb_crc #(
+		.WIDTH(5),
+		.POLY(5'b00101),
+		.MATCH(5'b01100),
+		.DW(8)
+	) crc5_par_I (
+		.in_data(byte_data),
+		.in_first(byte_first),
+		.in_valid(byte_valid),
+		.crc(crc5_par),
+		.crc_match(),
+		.clk(clk),
+		.rst(rst)
+	);
+
+	usb_crc #(
+		.WIDTH(16),
+		.POLY(16'h8005),
+		.MATCH(16'h800D),
+		.DW(1)
+	) crc16_ser_I (
+		.in_data(bit_data),
+		.in_first(bit_first),
+		.in_valid(bit_valid),
+		.crc(crc16_ser),
+		.crc_match(crc16_match_ser),
+		.clk(clk),
+		.rst(rst)
+	);
+
+	usb_crc #(
+		.WIDTH(16),
+		.POLY(16'h8005),
+		.MATCH(16'h800D),
+		.DW(8)
+	) crc16_par_I (
+		.in_data(byte_data),
+		.in_first(byte_first),
+		.in_valid(byte_valid),
+		.crc(crc16_par),
+		.crc_match(crc16_match_par),
+		.clk(clk),
+		.rst(rst)
+	);
+
+	// Feed the same bytes to both
+	task feed_byte(input [7:0] d, input first);
+		integer k;
+		begin
+			byte_data  <= d;
+			byte_first <= first;
+			byte_valid <= 1'b1;
+
+			for (k=0; k<8; k=k+1) begin
+				bit_data  <= d[k];
+				bit_first <= first & (k == 0);
+				bit_valid <= 1'b1;
+				@(posedge clk);
+				byte_valid <= 1'b0;
+			end
+
+			bit_valid <= 1'b0;
+		end
+	endtask
+
+	// Test sequence
+	integer pkt, len, i, errors, matches;
+	reg [15:0] crc;
+
+	initial begin
+		errors  = 0;
+		matches = 0;
+
+		byte_valid = 1'b0;
+		bit_valid  = 1'b0;
+
+		# 200 rst = 0;
+		@(posedge clk);
+
+		for (pkt=0; pkt<256; pkt=pkt+1) begin
+			// Random payload
+			len = ($random & 63) + 1;
+			for (i=0; i<len; i=i+1)
+				feed_byte($random, i == 0);
+			@(posedge clk);
+
+			if ((crc5_ser !== crc5_par) || (crc16_ser !== crc16_par)) begin
+				$display("Packet %0d : CRC5 %h / %h CRC16 %h / %h", pkt,
+					crc5_ser, crc5_par, crc16_ser, crc16_par);
+				errors = errors + 1;
+			end
+
+			// Append the CRC16 and check the residual is matched
+			crc = crc16_par;
+			feed_byte(crc[ 7:0], 1'b0);
+			feed_byte(crc[15:8], 1'b0);
+			@(posedge clk);
+
+			if (crc16_match_ser & crc16_match_par)
+				matches = matches + 1;
+			else
+				errors = errors + 1;
+		end
+
+		$display("Packets : 256, residual matches : %0d, errors : %0d", matches, errors);
+		$display("%s", errors ? "FAIL" : "PASS");
+
+		$finish;
+	end
+
+endmodule // usb_crc_tb
@@ -28,22 +28,34 @@
 
 module usb_ep_buf_tb;
 
-	localparam integer RWIDTH = 16;	// 8/16/32
-	localparam integer WWIDTH = 64;	// 8/16/32
+	localparam integer CWIDTH = 32;	// CPU side width: 8/16/32/64
+	localparam integer AWIDTH = 12;	// Buffer size (bytes, log2)
 
-	localparam integer ARW = 11 - $clog2(RWIDTH / 8);
-	localparam integer AWW = 11 - $clog2(WWIDTH / 8);
+	localparam integer CB  = CWIDTH / 8;
+	localparam integer ACW = AWIDTH - $clog2(CB);
+
+	localparam integer NBYTES = 1 << AWIDTH;
+	localparam integer NWORDS = 1 << ACW;
 
 	// Signals
 	reg rst = 1;
 	reg clk  = 0;
 
-	wire [ARW-1:0] rd_addr_0;
-	wire [RWIDTH-1:0] rd_data_1;
-	wire rd_en_0;
-	wire [AWW-1:0] wr_addr_0;
-	wire [WWIDTH-1:0] wr_data_0;
-	wire wr_en_0;
+		// TX direction: CPU writes wide, USB reads bytes
+	reg  [ACW-1:0] tx_wr_addr_0;
+	reg  [CWIDTH-1:0] tx_wr_data_0;
+	reg  tx_wr_en_0;
+	reg  [AWIDTH-1:0] tx_rd_addr_0;
+	wire [7:0] tx_rd_data_1;
+	reg  tx_rd_en_0;
+
+		// RX direction: USB writes bytes, CPU reads wide
+	reg  [AWIDTH-1:0] rx_wr_addr_0;
+	reg  [7:0] rx_wr_data_0;
+	reg  rx_wr_en_0;
+	reg  [ACW-1:0] rx_rd_addr_0;
+	wire [CWIDTH-1:0] rx_rd_data_1;
+	reg  rx_rd_en_0;
 
 	// Setup recording
 	initial begin
@@ -51,34 +63,151 @@ module usb_ep_buf_tb;
 		$dumpvars(0,usb_ep_buf_tb);
 	end
 
-	// Reset pulse
-	initial begin
-		# 200 rst = 0;
-		# 1000000 $finish;
-	end
-
 	// Clocks
 	always #10 clk  = !clk;
 
-	// DUT
+	// DUTs
 	usb_ep_buf #(
-		.RWIDTH(RWIDTH),
-		.WWIDTH(WWIDTH)
-	) dut_I (
-		.rd_addr_0(rd_addr_0),
-		.rd_data_1(rd_data_1),
-		.rd_en_0(rd_en_0),
+		.RWIDTH(8),
+		.WWIDTH(CWIDTH),
+		.AWIDTH(AWIDTH)
+	) tx_buf_I (
+		.rd_addr_0(tx_rd_addr_0),
+		.rd_data_1(tx_rd_data_1),
+		.rd_en_0(tx_rd_en_0),
 		.rd_clk(clk),
-		.wr_addr_0(wr_addr_0),
-		.wr_data_0(wr_data_0),
-		.wr_en_0(wr_en_0),
+		.wr_addr_0(tx_wr_addr_0),
+		.wr_data_0(tx_wr_data_0),
+		.wr_en_0(tx_wr_en_0),
 		.wr_clk(clk)
 	);
 
-	assign rd_en_0 = 1'b1;
-	assign wr_en_0 = 1'b1;
-	assign rd_addr_0 = 3;
-	assign wr_addr_0 = 0;
-	assign wr_data_0 = 64'hab89127bbabecafe;
+	usb_ep_buf #(
+		.RWIDTH(CWIDTH),
+		.WWIDTH(8),
+		.AWIDTH(AWIDTH)
+	) rx_buf_I (
+		.rd_addr_0(rx_rd_addr_0),
+		.rd_data_1(rx_rd_data_1),
+		.rd_en_0(rx_rd_en_0),
+		.rd_clk(clk),
+		.wr_addr_0(rx_wr_addr_0),
+		.wr_data_0(rx_wr_data_0),
+		.wr_en_0(rx_wr_en_0),
+		.wr_clk(clk)
+	);
+
+	// Reference pattern
+	function [7:0] pattern(input integer byte_addr, input integer seed);
+		pattern = (byte_addr * 8'h3b) ^ (byte_addr >> 8) ^ seed;
+	endfunction
+
+	function [CWIDTH-1:0] pattern_word(input integer word_addr, input integer seed);
+		integer k;
+		begin
+			for (k=0; k<CB; k=k+1)
+				pattern_word[k*8+:8] = pattern(word_addr * CB + k, seed);
+		end
+	endfunction
+
+	// Test sequence
+	integer i, errors, t_start, t_cycles;
+
+	initial begin
+		errors = 0;
+
+		tx_wr_en_0 = 1'b0;
+		tx_rd_en_0 = 1'b0;
+		rx_wr_en_0 = 1'b0;
+		rx_rd_en_0 = 1'b0;
+
+		# 200 rst = 0;
+		@(posedge clk);
+
+		// Wide write / Byte read
+		for (i=0; i<NWORDS; i=i+1) begin
+			tx_wr_addr_0 <= i;
+			tx_wr_data_0 <= pattern_word(i, 8'h5a);
+			tx_wr_en_0   <= 1'b1;
+			@(posedge clk);
+		end
+		tx_wr_en_0 <= 1'b0;
+
+		for (i=0; i<NBYTES; i=i+1) begin
+			tx_rd_addr_0 <= i;
+			tx_rd_en_0   <= 1'b1;
+			@(posedge clk);
+			tx_rd_en_0   <= 1'b0;
+			@(posedge clk);
+			#1 if (tx_rd_data_1 !== pattern(i, 8'h5a)) begin
+				if (errors < 16)
+					$display("TX byte %h : got %h expected %h", i, tx_rd_data_1, pattern(i, 8'h5a));
+				errors = errors + 1;
+			end
+		end
+
+		// Byte write / Wide read
+		for (i=0; i<NBYTES; i=i+1) begin
+			rx_wr_addr_0 <= i;
+			rx_wr_data_0 <= pattern(i, 8'hc3);
+			rx_wr_en_0   <= 1'b1;
+			@(posedge clk);
+		end
+		rx_wr_en_0 <= 1'b0;
+
+		for (i=0; i<NWORDS; i=i+1) begin
+			rx_rd_addr_0 <= i;
+			rx_rd_en_0   <= 1'b1;
+			@(posedge clk);
+			rx_rd_en_0   <= 1'b0;
+			@(posedge clk);
+			#1 if (rx_rd_data_1 !== pattern_word(i, 8'hc3)) begin
+				if (errors < 16)
+					$display("RX word %h : got %h expected %h", i, rx_rd_data_1, pattern_word(i, 8'hc3));
+				errors = errors + 1;
+			end
+		end
+
+		// CPU side copy bandwidth: RX buffer -> TX buffer, pipelined
+		// with one read issued every cycle and written back as soon as
+		// the read data is available
+		t_start = $time;
+
+		for (i=0; i<=NWORDS; i=i+1) begin
+			rx_rd_addr_0 <= i;
+			rx_rd_en_0   <= (i < NWORDS);
+			tx_wr_addr_0 <= i - 1;
+			tx_wr_en_0   <= (i > 0);
+			@(posedge clk);
+			#1 tx_wr_data_0 = rx_rd_data_1;
+		end
+		rx_rd_en_0 <= 1'b0;
+		tx_wr_en_0 <= 1'b0;
+
+		t_cycles = ($time - t_start) / 20;
+
+		for (i=0; i<NBYTES; i=i+1) begin
+			tx_rd_addr_0 <= i;
+			tx_rd_en_0   <= 1'b1;
+			@(posedge clk);
+			tx_rd_en_0   <= 1'b0;
+			@(posedge clk);
+			#1 if (tx_rd_data_1 !== pattern(i, 8'hc3)) begin
+				if (errors < 16)
+					$display("Copy byte %h : got %h expected %h", i, tx_rd_data_1, pattern(i, 8'hc3));
+				errors = errors + 1;
+			end
+		end
+
+		// Report
+		$display("CPU width  : %0d bits", CWIDTH);
+		$display("Buffer     : %0d bytes", NBYTES);
+		$display("Copy       : %0d bytes in %0d cycles (%0d MB/s @ 48 MHz)",
+			NBYTES, t_cycles, (NBYTES * 48) / t_cycles);
+		$display("Errors     : %0d", errors);
+		$display("%s", errors ? "FAIL" : "PASS");
+
+		$finish;
+	end
 
 endmodule // usb_ep_buf_tb
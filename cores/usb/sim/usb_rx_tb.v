@@ -0,0 +1,314 @@
+/*
+ * usb_rx_tb.v
+ *
+ * vim: ts=4 sw=4
+ *
+ * Copyright (C) 2019 Sylvain Munaut
+ * All rights reserved.
+ *
+ * LGPL v3+, see LICENSE.lgpl3
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+`default_nettype none
+`timescale 1ns/1ps
+
+/*
+ * Replays a raw line capture through usb_phy / usb_rx_ll / usb_rx_pkt
+ *
+ * Capture format is one byte per sample, bit 1 = D+, bit 0 = D-.
+ *
+ * Options (plusargs) :
+ *   +capture=<file>  Capture to replay (default ../data/capture_usb_raw_short.bin)
+ *   +samp_ps=<n>     Capture sample period in ps (default 6494, ~154 MHz)
+ *   +jitter_ps=<n>   Random peak jitter added to each sample edge
+ *   +ppm=<n>         USB clock frequency offset, in ppm
+ *   +seed=<n>        Seed for the jitter generator
+ *   +quiet           Don't print each packet, only the summary
+ *   +vcd             Dump waveforms (avoid on long captures)
+ *
+ * The summary line at the end ("SUMMARY ...") is meant to be parsed by
+ * scripts (see utils/rx_replay.py).
+ */
+
+module usb_rx_tb;
+
+	`include "usb_defs.vh"
+
+	// Signals
+	reg rst = 1;
+	reg clk_48m  = 0;	// USB clock
+	reg clk_samp = 0;	// Capture samplerate
+
+	reg  [7:0] in_file_data;
+	reg  in_file_valid;
+	reg  in_file_done;
+
+	wire usb_dp;
+	wire usb_dn;
+
+	wire phy_rx_dp;
+	wire phy_rx_dn;
+	wire phy_rx_chg;
+
+	wire [1:0] rxll_sym;
+	wire rxll_bit;
+	wire rxll_valid;
+	wire rxll_eop;
+	wire rxll_sync;
+	wire rxll_bs_skip;
+	wire rxll_bs_err;
+
+	wire rxpkt_start;
+	wire rxpkt_done_ok;
+	wire rxpkt_done_err;
+	wire [ 3:0] rxpkt_pid;
+	wire rxpkt_is_sof;
+	wire rxpkt_is_token;
+	wire rxpkt_is_data;
+	wire rxpkt_is_handshake;
+	wire [10:0] rxpkt_frameno;
+	wire [ 6:0] rxpkt_addr;
+	wire [ 3:0] rxpkt_endp;
+	wire [ 7:0] rxpkt_data;
+	wire rxpkt_data_stb;
+
+	// Options
+	integer fh_in, rv;
+	reg [1023:0] capture;
+	integer samp_ps   = 6494;
+	integer jitter_ps = 0;
+	integer ppm       = 0;
+	integer seed      = 1;
+	reg     quiet     = 1'b0;
+
+	initial begin
+		if (!$value$plusargs("capture=%s", capture))
+			capture = "../data/capture_usb_raw_short.bin";
+		rv = $value$plusargs("samp_ps=%d", samp_ps);
+		rv = $value$plusargs("jitter_ps=%d", jitter_ps);
+		rv = $value$plusargs("ppm=%d", ppm);
+		rv = $value$plusargs("seed=%d", seed);
+		quiet = $test$plusargs("quiet");
+
+		fh_in = $fopen(capture, "rb");
+		if (fh_in == 0) begin
+			$display("Unable to open capture '%0s'", capture);
+			$finish;
+		end
+	end
+
+	// Setup recording
+	initial begin
+		if ($test$plusargs("vcd")) begin
+			$dumpfile("usb_rx_tb.vcd");
+			$dumpvars(0,usb_rx_tb);
+		end
+	end
+
+	// Reset pulse
+	initial begin
+		# 200 rst = 0;
+	end
+
+	// Clocks
+	real samp_half;
+
+	always #(10.416667 * (1.0 - ppm * 1.0e-6)) clk_48m = !clk_48m;
+
+	always begin
+		samp_half = samp_ps / 2000.0;
+		if (jitter_ps != 0)
+			samp_half = samp_half + (($random(seed) % (jitter_ps + 1)) / 1000.0);
+		#(samp_half) clk_samp = !clk_samp;
+	end
+
+	// DUT
+	usb_phy #(
+		.TARGET("ECP5")
+	) phy_I (
+		.pad_dp(usb_dp),
+		.pad_dn(usb_dn),
+		.rx_dp(phy_rx_dp),
+		.rx_dn(phy_rx_dn),
+		.rx_chg(phy_rx_chg),
+		.tx_dp(1'b0),
+		.tx_dn(1'b0),
+		.tx_en(1'b0),
+		.clk(clk_48m),
+		.rst(rst)
+	);
+
+	usb_rx_ll rx_ll_I (
+		.phy_rx_dp(phy_rx_dp),
+		.phy_rx_dn(phy_rx_dn),
+		.phy_rx_chg(phy_rx_chg),
+		.ll_sym(rxll_sym),
+		.ll_bit(rxll_bit),
+		.ll_valid(rxll_valid),
+		.ll_eop(rxll_eop),
+		.ll_sync(rxll_sync),
+		.ll_bs_skip(rxll_bs_skip),
+		.ll_bs_err(rxll_bs_err),
+		.clk(clk_48m),
+		.rst(rst)
+	);
+
+	usb_rx_pkt rx_pkt_I (
+		.ll_sym(rxll_sym),
+		.ll_bit(rxll_bit),
+		.ll_valid(rxll_valid),
+		.ll_eop(rxll_eop),
+		.ll_sync(rxll_sync),
+		.ll_bs_skip(rxll_bs_skip),
+		.ll_bs_err(rxll_bs_err),
+		.pkt_start(rxpkt_start),
+		.pkt_done_ok(rxpkt_done_ok),
+		.pkt_done_err(rxpkt_done_err),
+		.pkt_pid(rxpkt_pid),
+		.pkt_is_sof(rxpkt_is_sof),
+		.pkt_is_token(rxpkt_is_token),
+		.pkt_is_data(rxpkt_is_data),
+		.pkt_is_handshake(rxpkt_is_handshake),
+		.pkt_frameno(rxpkt_frameno),
+		.pkt_addr(rxpkt_addr),
+		.pkt_endp(rxpkt_endp),
+		.pkt_data(rxpkt_data),
+		.pkt_data_stb(rxpkt_data_stb),
+		.inhibit(1'b0),
+		.clk(clk_48m),
+		.rst(rst)
+	);
+
+
+	// Statistics
+	// ----------
+
+	integer n_ok       = 0;
+	integer n_err      = 0;
+	integer n_crc_err  = 0;
+	integer n_adj      = 0;
+	integer n_slip     = 0;
+	integer n_cycles   = 0;
+	integer pkt_cycles = 0;
+	integer pkt_cyc_tot = 0;
+	integer pkt_len    = 0;
+	reg     in_pkt     = 1'b0;
+
+	always @(posedge clk_48m)
+		if (!rst)
+			n_cycles <= n_cycles + 1;
+
+	// Packet timing : from SYNC detection to done
+	always @(posedge clk_48m)
+	begin
+		if (rxll_valid & rxll_sync & (rx_pkt_I.state == rx_pkt_I.ST_IDLE)) begin
+			in_pkt     <= 1'b1;
+			pkt_cycles <= 0;
+			pkt_len    <= 0;
+		end else if (in_pkt) begin
+			pkt_cycles <= pkt_cycles + 1;
+			pkt_len    <= pkt_len + rxpkt_data_stb;
+		end
+
+		if (rxpkt_done_ok | rxpkt_done_err) begin
+			in_pkt      <= 1'b0;
+			pkt_cyc_tot <= pkt_cyc_tot + pkt_cycles;
+		end
+	end
+
+	// CRC errors : EOP at the right place, but CRC doesn't match
+	always @(posedge clk_48m)
+		if (rxll_valid & rxll_eop & rx_pkt_I.bit_eop_ok)
+			if (((rx_pkt_I.state == rx_pkt_I.ST_WAIT_EOP) & ~rx_pkt_I.crc5_ok & ~rx_pkt_I.pid_is_handshake) |
+			    ((rx_pkt_I.state == rx_pkt_I.ST_DATA) & ~rx_pkt_I.crc16_ok))
+				n_crc_err <= n_crc_err + 1;
+
+	// Clock recovery : a transition while tracking normally lands with
+	// samp_cnt == 3'b010. One clock off is a phase adjustment, two is half
+	// a bit off and counted as a slip.
+	always @(posedge clk_48m)
+		if (rx_ll_I.samp_active & phy_rx_chg & ~rx_ll_I.samp_cnt[2])
+			case (rx_ll_I.samp_cnt[1:0])
+				2'b10:   ;
+				2'b00:   n_slip <= n_slip + 1;
+				default: n_adj  <= n_adj  + 1;
+			endcase
+
+	// Packets
+	always @(posedge clk_48m)
+	begin
+		if (rxpkt_done_ok) begin
+			n_ok <= n_ok + 1;
+			if (!quiet) begin
+				if (rxpkt_is_sof)
+					$display("%10d  SOF    frame=%0d", n_cycles, rxpkt_frameno);
+				else if (rxpkt_is_token)
+					$display("%10d  %0s  addr=%0d ep=%0d",  n_cycles,
+						(rxpkt_pid == PID_SETUP) ? "SETUP" : (rxpkt_pid == PID_IN) ? "IN" : "OUT",
+						rxpkt_addr, rxpkt_endp);
+				else if (rxpkt_is_data)
+					$display("%10d  DATA%0d  len=%0d", n_cycles, rxpkt_pid[3], pkt_len - 2);
+				else
+					$display("%10d  HS     pid=%h", n_cycles, rxpkt_pid);
+			end
+		end
+
+		if (rxpkt_done_err) begin
+			n_err <= n_err + 1;
+			if (!quiet)
+				$display("%10d  ERROR", n_cycles);
+		end
+	end
+
+
+	// Read file
+	// ---------
+
+	always @(posedge clk_samp)
+	begin
+		if (rst) begin
+			in_file_data  <= 8'h00;
+			in_file_valid <= 1'b0;
+			in_file_done  <= 1'b0;
+		end else begin
+			if (!in_file_done) begin
+				rv = $fread(in_file_data, fh_in);
+				in_file_valid <= (rv == 1);
+				in_file_done  <= (rv != 1);
+			end else begin
+				in_file_data  <= 8'h00;
+				in_file_valid <= 1'b0;
+				in_file_done  <= 1'b1;
+			end
+		end
+	end
+
+	// Input
+	assign usb_dp = in_file_data[1] & in_file_valid;
+	assign usb_dn = in_file_data[0] & in_file_valid;
+
+	// Summary once the capture is exhausted (and the pipeline flushed)
+	always @(posedge in_file_done)
+	begin
+		# 10000;
+		$display("SUMMARY packets=%0d errors=%0d crc_errors=%0d dpll_adjust=%0d dpll_slips=%0d cycles=%0d cycles_per_pkt=%0d",
+			n_ok, n_err, n_crc_err, n_adj, n_slip, n_cycles,
+			(n_ok + n_err) ? (pkt_cyc_tot / (n_ok + n_err)) : 0);
+		$finish;
+	end
+
+endmodule // usb_rx_tb
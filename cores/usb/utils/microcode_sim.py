@@ -0,0 +1,466 @@
+#!/usr/bin/env python3
+
+#
+# Cycle level simulator / profiler for the usb_trans microcode
+#
+# This runs the exact code produced by microcode.py through a model of the
+# usb_trans execution engine (one instruction per cycle, registered ROM
+# read, A register, event latch, RX timeout counter and EP status fetch
+# pipeline) and reports, for each transaction path, how many instructions
+# are executed between the token and the response, and how that
+# turnaround compares to the USB inter-packet deadline.
+#
+# Usage:
+#   microcode_sim.py [--trace] [--rx-lat N] [--tx-lat N] [scenario ...]
+#
+
+import argparse
+import sys
+
+from microcode import *
+
+
+#
+# Timing constants (in 48 MHz clock cycles)
+#
+
+CLK_PER_BIT = 4			# Full Speed : 12 Mbps
+
+# USB 2.0 7.1.18.1 : a device must respond within 6.5 bit times and the
+# host will give up after 16 bit times. Both are measured on the bus from
+# the end of the EOP to the start of the SYNC.
+DEADLINE_DEV  = 6.5
+DEADLINE_HOST = 16
+
+# Packet pipeline latencies, derived from the RTL (ECP5 PHY). Bus events
+# are at the pads, cycle `n` is the one after clock edge `n`.
+#
+# RX : SE0 to J transition ending the EOP -> `rxpkt_done_ok` high
+#   usb_phy     IDDRX1F register + 2 state filter   2.5 .. 3.5  rx_chg
+#   usb_rx_ll   resync, samp_valid_0 on the J        +2         (sample)
+#               dec_eop_state_1 / dec_valid_1        +1         ll_eop
+#   usb_rx_pkt  state -> ST_IDLE                     +1
+#               pkt_done_ok register                 +1
+#   Total : 7.5 .. 8.5, 8 used
+#
+# TX : cycle a `TX` opcode executes -> J to K transition starting SYNC
+#   usb_trans   txpkt_start_i                        1
+#   usb_tx_pkt  ST_SYNC, then ll_start               +2
+#   usb_tx_ll   state active, first br_now           +2
+#               out_sym <= K                         +1
+#   usb_phy     OFS1P3DX output register             +1
+#   Total : 7
+RX_LAT = 8
+TX_LAT = 7
+
+# EP status fetch pipeline (see epfw in usb_trans.v) : delay from the
+# `rxpkt_done_ok` cycle of a token (X) to the captured values being
+# usable by a `LD` opcode.
+#   X+1  epfw_state = RD_STATUS, eps_addr_0 (trans_endp / trans_dir)
+#   X+4  p_dout_3 (usb_ep_status 3 stages), epfw_cap_dl[1:0] = 01
+#   X+5  ep_type / ep_data_toggle / ep_bd_idx_cur captured
+#   X+5  epfw_state = RD_BD_W0, p_dout_3 at X+8, cap_dl[1:0] = 10
+#   X+9  bd_state captured
+EPFW_LAT_STATUS = 5
+EPFW_LAT_BD     = 9
+
+
+#
+# Disassembler
+#
+
+LD_SRCS = { 0: 'evt', 2: 'pkt_pid', 3: 'pkt_pid_chk', 4: 'ep_type', 6: 'bd_state' }
+
+def disasm(op, ilabel):
+	if op & 0x8000:
+		tgt = ((op >> 8) & 0x3f) << 2
+		tgt = ilabel.get(tgt, '%02x' % tgt)
+		if (op & 0xff) == 0:
+			return 'JMP %s' % tgt if not (op & 0x4000) else 'NOP'
+		return '%s %s, val=%x, msk=%x' % (
+			'JNE' if (op & 0x4000) else 'JEQ', tgt, op & 0xf, (op >> 4) & 0xf)
+	opc = op >> 12
+	if opc == 0x0:
+		return 'NOP'
+	elif opc == 0x1:
+		return 'LD %s' % LD_SRCS.get(op & 7, '?')
+	elif opc == 0x2:
+		a = []
+		if op & (1 << 2): a.append('bd_state=%d' % ((op >> 3) & 7))
+		if op & (1 << 1): a.append('bdi_flip')
+		if op & (1 << 0): a.append('dt_flip')
+		if op & (1 << 7): a.append('wb')
+		if op & (1 << 8): a.append('cel_set')
+		return 'EP %s' % ', '.join(a)
+	elif opc == 0x3:
+		return 'ZL'
+	elif opc == 0x4:
+		return 'TX %x%s' % (op & 0xf, ', set_dt' if op & 0x10 else '')
+	elif opc == 0x5:
+		return 'NOTIFY %x' % (op & 0xf)
+	elif opc == 0x6:
+		return 'EVT_CLR %x' % (op & 0xf)
+	elif opc == 0x7:
+		return 'EVT_RTO %d' % (op & 0xff)
+	return '???'
+
+
+#
+# Packets duration on the bus (in cycles, without bit stuffing)
+#
+
+def pkt_cycles(pid, length=0):
+	bits = 8 + 8						# SYNC + PID
+	if (pid & 3) == 1:					# Token
+		bits += 16
+	elif (pid & 3) == 3:				# Data
+		bits += (length + 2) * 8
+	bits += 2							# EOP SE0, ends on the SE0 to J transition
+	return bits * CLK_PER_BIT
+
+
+#
+# Engine model
+#
+
+class Engine:
+
+	def __init__(self, code, labels, ep_type, bd_state, dt=0, cel=0, rx_lat=RX_LAT, tx_lat=TX_LAT, trace=False):
+		self.code   = code
+		self.labels = labels
+		self.ilabel = dict([(v,k) for k,v in labels.items()])
+		self.rx_lat = rx_lat
+		self.tx_lat = tx_lat
+		self.trace  = trace
+
+		# Architectural state
+		self.pc      = 0
+		self.a_reg   = 0
+		self.evt     = 0
+		self.rto_cnt = 0
+		self.pkt_pid = 0
+
+		# EP state (as fetched by epfw, and the values in RAM)
+		self.ram_ep_type  = ep_type
+		self.ram_bd_state = bd_state
+		self.ram_dt       = dt
+		self.cel_state    = cel
+		self.trans_cel    = 0
+		self.ep_type      = 0
+		self.bd_state     = 0
+		self.dt           = 0
+		self.ep_valid     = None
+		self.bd_valid     = None
+		self.zl           = False
+
+		# Simulation
+		self.cycle    = 0
+		self.pending  = []		# (cycle, kind, pid)
+		self.log      = []		# (cycle, what, arg)
+		self.hazards  = []
+		self.on_tx    = None	# Host reaction hook
+		self.t_start  = 0
+		self.t_trace  = 0
+
+	# Environment
+	def schedule(self, cycle, kind, pid=None):
+		self.pending.append((cycle, kind, pid))
+
+	def host_send(self, start, pid, length=0):
+		# Packet starting on the bus at `start`, returns the SE0 to J
+		# transition of its EOP. `rxpkt_start` is only raised once the
+		# last PID bit has gone through the RX pipeline.
+		end = start + pkt_cycles(pid, length)
+		self.schedule(start + 15 * CLK_PER_BIT + self.rx_lat, 'rx_start', pid)
+		self.schedule(end + self.rx_lat, 'rx_ok', pid)
+		return end
+
+	# One clock cycle
+	def step(self):
+		t = self.cycle
+
+		# External inputs active this cycle
+		evt_set   = 0
+		rx_start  = False
+		for e in [e for e in self.pending if e[0] == t]:
+			self.pending.remove(e)
+			_, kind, pid = e
+			if kind == 'rx_start':
+				rx_start = True
+			elif kind == 'rx_ok':
+				evt_set |= EVT_RX_OK
+				self.log.append((t, 'rx', pid))
+				self._rx_done(t, pid)
+			elif kind == 'rx_err':
+				evt_set |= EVT_RX_ERR
+			elif kind == 'tx_done':
+				evt_set |= EVT_TX_DONE
+				self.log.append((t, 'tx_done', pid))
+
+		if (self.rto_cnt & 0x200) and not (self.rto_cnt & 0x100):
+			evt_set |= EVT_TIMEOUT
+
+		# Execute opcode fetched at previous cycle
+		op = self.code[self.pc]
+		if self.trace and (t >= self.t_trace):
+			print("%5d  %02x %-22s %s" % (t, self.pc, self.ilabel.get(self.pc, ''), disasm(op, self.ilabel)))
+
+		nxt_pc   = self.pc + 1
+		nxt_a    = self.a_reg
+		evt_rst  = 0
+		rto_load = None
+		opc      = op >> 12
+
+		if op & 0x8000:
+			match = ((self.a_reg & (op >> 4)) ^ op) & 0xf == 0
+			if match ^ bool(op & 0x4000):
+				nxt_pc = ((op >> 8) & 0x3f) << 2
+
+		elif opc == 0x1:
+			src = op & 7
+			if src == 0:
+				nxt_a = self.evt
+			elif src in (2, 3):
+				if src == 3:
+					self._check(t, self.ep_valid, 'ep_data_toggle')
+				nxt_a = self.pkt_pid ^ ((self.dt & src & 1) << 3)
+			elif src == 4:
+				self._check(t, self.ep_valid, 'ep_type')
+				nxt_a = (self.trans_cel << 3) | self.ep_type
+			elif src == 6:
+				self._check(t, self.bd_valid, 'bd_state')
+				nxt_a = self.bd_state
+
+		elif opc == 0x2:
+			if op & (1 << 0):
+				self.dt ^= 1
+			if op & (1 << 2):
+				self.bd_state = (op >> 3) & 7
+			if op & (1 << 8):
+				self.cel_state = 1
+			if op & (1 << 7):
+				self.ram_bd_state = self.bd_state
+				self.ram_dt       = self.dt
+				self.log.append((t, 'wb', self.bd_state))
+
+		elif opc == 0x3:
+			self.zl = True
+
+		elif opc == 0x4:
+			pid = (op & 0xf) ^ ((self.dt << 3) if op & 0x10 else 0)
+			self.log.append((t, 'tx', pid))
+			end = t + self.tx_lat + pkt_cycles(pid, 0 if self.zl else 8)
+			self.schedule(end, 'tx_done', pid)
+			if self.on_tx:
+				self.on_tx(self, t + self.tx_lat, end, pid)
+
+		elif opc == 0x5:
+			self.log.append((t, 'notify', op & 0xf))
+
+		elif opc == 0x6:
+			evt_rst = op & 0xf
+
+		elif opc == 0x7:
+			rto_load = op & 0xff
+
+		# Register updates
+		self.evt   = (self.evt & ~evt_rst) | evt_set
+		self.a_reg = nxt_a
+		self.pc    = nxt_pc
+
+		if rto_load is not None:
+			# Same load value as the RTL. Note that with bit 9 clear, the
+			# counter never runs, so EVT_TIMEOUT never fires and a missing
+			# packet only resolves when the next one arrives.
+			self.rto_cnt = (1 << 8) | rto_load
+		else:
+			b9 = (self.rto_cnt >> 9) & (self.rto_cnt >> 8) & (0 if rx_start else 1)
+			self.rto_cnt = (b9 << 9) | ((self.rto_cnt - ((self.rto_cnt >> 9) & 1)) & 0x1ff)
+
+		self.cycle += 1
+
+	def _rx_done(self, t, pid):
+		if (pid & 3) == 1:
+			# Token : start EP status fetch
+			self.pkt_pid   = pid
+			self.trans_cel = self.cel_state
+			self.ep_type   = self.ram_ep_type
+			self.bd_state  = self.ram_bd_state
+			self.dt        = 0 if pid == PID_SETUP else self.ram_dt
+			self.ep_valid  = t + EPFW_LAT_STATUS
+			self.bd_valid  = t + EPFW_LAT_BD
+			self.zl        = False
+		else:
+			self.pkt_pid   = pid
+
+	def _check(self, t, valid, what):
+		if valid is None or t < valid:
+			self.hazards.append((t, what))
+
+	def idle(self):
+		return (self.pc == self.labels['IDLE']) and (self.evt == 0) and not self.pending
+
+	def run(self, max_cycles=2000):
+		while self.cycle < max_cycles:
+			self.step()
+			if self.idle() and self.cycle > self.t_start:
+				return True
+		return False
+
+
+#
+# Scenarios
+#
+
+def host_reply(pid, length=0, delay=4):
+	# Host sends `pid` `delay` bit times after the device packet ended
+	def cb(eng, start, end, tx_pid):
+		eng.host_send(end + delay * CLK_PER_BIT, pid, length)
+	return cb
+
+SCENARIOS = [
+	# name, pid, data_pid, ep_type, bd_state, dt, cel, host reply after device TX
+	('SETUP',              PID_SETUP, PID_DATA0, EP_TYPE_CTRL, BD_RDY_DATA,  0, 0, None),
+	('SETUP no BD',        PID_SETUP, PID_DATA0, EP_TYPE_CTRL, BD_NONE,      0, 0, None),
+	('IN data',            PID_IN,    None,      EP_TYPE_BULK, BD_RDY_DATA,  0, 0, host_reply(PID_ACK)),
+	('IN data, no ACK',    PID_IN,    None,      EP_TYPE_BULK, BD_RDY_DATA,  0, 0, None),
+	('IN NAK',             PID_IN,    None,      EP_TYPE_BULK, BD_NONE,      0, 0, None),
+	('IN NAK (CEL)',       PID_IN,    None,      EP_TYPE_CTRL, BD_RDY_DATA,  0, 1, None),
+	('IN STALL (halt)',    PID_IN,    None,      EP_TYPE_BULK | EP_TYPE_HALT, BD_RDY_DATA, 0, 0, None),
+	('IN STALL (BD)',      PID_IN,    None,      EP_TYPE_BULK, BD_RDY_STALL, 0, 0, None),
+	('IN ISOC',            PID_IN,    None,      EP_TYPE_ISOC, BD_RDY_DATA,  0, 0, None),
+	('IN ISOC, no data',   PID_IN,    None,      EP_TYPE_ISOC, BD_NONE,      0, 0, None),
+	('OUT data',           PID_OUT,   PID_DATA0, EP_TYPE_BULK, BD_RDY_DATA,  0, 0, None),
+	('OUT DT mismatch',    PID_OUT,   PID_DATA1, EP_TYPE_BULK, BD_RDY_DATA,  0, 0, None),
+	('OUT NAK',            PID_OUT,   PID_DATA0, EP_TYPE_BULK, BD_NONE,      0, 0, None),
+	('OUT STALL (halt)',   PID_OUT,   PID_DATA0, EP_TYPE_BULK | EP_TYPE_HALT, BD_RDY_DATA, 0, 0, None),
+	('OUT ISOC',           PID_OUT,   PID_DATA0, EP_TYPE_ISOC, BD_RDY_DATA,  0, 0, None),
+]
+
+def run_scenario(code, labels, sc, phase, args):
+	name, pid, data_pid, ep_type, bd_state, dt, cel, reply = sc
+
+	eng = Engine(code, labels, ep_type, bd_state, dt, cel,
+		rx_lat=args.rx_lat, tx_lat=args.tx_lat, trace=args.trace)
+	eng.on_tx = reply
+
+	# Let the engine settle in the IDLE loop, then send the token with a
+	# given phase relative to the loop
+	t0 = 16 + phase
+	eng.t_start = t0
+	tok_end = eng.host_send(t0, pid)
+	eng.t_trace = tok_end + args.rx_lat
+	last_end = tok_end
+	if data_pid is not None:
+		last_end = eng.host_send(tok_end + 4 * CLK_PER_BIT, data_pid, 8)
+
+	ok = eng.run()
+
+	# Response latency : from the end of the last host packet on the bus
+	# to the device SYNC on the bus
+	resp = None
+	for t, what, arg in eng.log:
+		if what == 'tx':
+			resp = (t, arg)
+			break
+
+	rx_ok_t = last_end + args.rx_lat
+	res = {
+		'ok':      ok,
+		'stuck':   None if ok else eng.ilabel.get(eng.pc & ~3, '%02x' % eng.pc),
+		'cycles':  eng.cycle - rx_ok_t,
+		'log':     eng.log,
+		'hazards': eng.hazards,
+		'resp':    None,
+	}
+	if resp is not None:
+		res['resp']    = resp[1]
+		res['instr']   = resp[0] - rx_ok_t		# instructions between RX done and TX
+		res['bus_clk'] = (resp[0] + args.tx_lat) - last_end
+	return res
+
+
+#
+# Main
+#
+
+PID_NAMES = {
+	PID_OUT: 'OUT', PID_IN: 'IN', PID_SETUP: 'SETUP',
+	PID_DATA0: 'DATA0', PID_DATA1: 'DATA1',
+	PID_ACK: 'ACK', PID_NAK: 'NAK', PID_STALL: 'STALL',
+}
+
+def main():
+	parser = argparse.ArgumentParser(description='usb_trans microcode simulator / profiler')
+	parser.add_argument('--rx-lat', type=int, default=RX_LAT,
+		help='Cycles from the EOP SE0 to J transition on the bus to rxpkt_done_ok (default: %(default)s)')
+	parser.add_argument('--tx-lat', type=int, default=TX_LAT,
+		help='Cycles from TX opcode to SYNC start on the bus (default: %(default)s)')
+	parser.add_argument('--trace', action='store_true',
+		help='Print executed instructions')
+	parser.add_argument('scenario', nargs='*',
+		help='Only run scenarios whose name starts with this')
+	args = parser.parse_args()
+
+	code, labels = assemble(mc)
+
+	print("Microcode: %d words, %d labels" % (len(code), len(labels)))
+	print("Latencies: RX %d cycles, TX %d cycles, deadline %.1f bits (device) / %d bits (host)" % (
+		args.rx_lat, args.tx_lat, DEADLINE_DEV, DEADLINE_HOST))
+	print()
+	print("%-20s %-6s %7s %7s %9s %8s  %s" % (
+		'Path', 'Resp', 'Instr', 'Bits', 'Margin', 'Total', 'Notes'))
+
+	fail = False
+
+	for sc in SCENARIOS:
+		if args.scenario and not any(sc[0].startswith(s) for s in args.scenario):
+			continue
+
+		# Run with all possible alignments of the token vs the IDLE loop
+		# and keep the worst case
+		runs = [run_scenario(code, labels, sc, p, args) for p in range(1 if args.trace else 4)]
+		worst = max(runs, key=lambda r: (r.get('bus_clk', 0), r['cycles']))
+
+		notes = []
+		if not all(r['ok'] for r in runs):
+			notes.append('STUCK in %s' % '/'.join(sorted(set(r['stuck'] for r in runs if r['stuck']))))
+			fail = True
+		if any(r['hazards'] for r in runs):
+			h = set(w for r in runs for _, w in r['hazards'])
+			notes.append('HAZARD: LD %s before fetch complete' % '/'.join(sorted(h)))
+			fail = True
+		notes += ['notify %x' % a for _, w, a in worst['log'] if w == 'notify']
+
+		if any((r['resp'] is None) != (worst['resp'] is None) for r in runs):
+			notes.append('INCONSISTENT: response depends on phase')
+			fail = True
+
+		if worst['resp'] is None:
+			print("%-20s %-6s %7s %7s %9s %8d  %s" % (
+				sc[0], '-', '-', '-', '-', worst['cycles'], ', '.join(notes)))
+			continue
+
+		bits   = worst['bus_clk'] / CLK_PER_BIT
+		margin = DEADLINE_DEV - bits
+		if bits > DEADLINE_HOST:
+			notes.append('MISSED host timeout')
+			fail = True
+		elif margin < 0:
+			notes.append('over device limit')
+
+		print("%-20s %-6s %3d-%-3d %7.2f %+9.2f %8d  %s" % (
+			sc[0], PID_NAMES.get(worst['resp'], '%x' % worst['resp']),
+			min(r['instr'] for r in runs), worst['instr'],
+			bits, margin, worst['cycles'], ', '.join(notes)))
+
+	print()
+	print("Instr : instructions between rxpkt_done_ok and TX (best-worst over IDLE loop phases)")
+	print("Bits  : worst case bus turnaround (EOP SE0 to J, to SYNC J to K), in bit times")
+	print("Total : cycles from rxpkt_done_ok until back in IDLE")
+
+	return 1 if fail else 0
+
+
+if __name__ == '__main__':
+	sys.exit(main())
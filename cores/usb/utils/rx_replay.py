@@ -0,0 +1,87 @@
+#!/usr/bin/env python3
+
+#
+# Drives the usb_rx_tb replay harness over one or more raw captures, with
+# optional jitter / clock offset sweeps, and tabulates the results.
+#
+# The simulation binary is either the iverilog output (build-tmp/usb_rx_tb)
+# or the Verilator one (build-tmp/usb_rx_tb_vl), both accept the same
+# plusargs and print the same SUMMARY line.
+#
+# Usage:
+#   rx_replay.py [--sim build-tmp/usb_rx_tb] [--jitter 0,200,400]
+#                [--ppm 0,2500] [--seeds 1] capture.bin [...]
+#
+
+import argparse
+import os
+import re
+import subprocess
+import sys
+
+
+def run(sim, capture, jitter, ppm, seed):
+	cmd = [
+		sim,
+		'+quiet',
+		'+capture=%s' % os.path.abspath(capture),
+		'+jitter_ps=%d' % jitter,
+		'+ppm=%d' % ppm,
+		'+seed=%d' % seed,
+	]
+	out = subprocess.run(cmd, cwd=os.path.dirname(os.path.abspath(sim)),
+		stdout=subprocess.PIPE, universal_newlines=True).stdout
+	for l in out.splitlines():
+		if l.startswith('SUMMARY'):
+			return dict((k, int(v)) for k, v in re.findall(r'(\w+)=(\d+)', l))
+	raise RuntimeError('No summary from simulation:\n' + out)
+
+
+def main():
+	parser = argparse.ArgumentParser(description='USB RX raw capture replay')
+	parser.add_argument('--sim', default='build-tmp/usb_rx_tb',
+		help='Simulation binary (default: %(default)s)')
+	parser.add_argument('--jitter', default='0',
+		help='Comma separated list of sample jitter values, in ps')
+	parser.add_argument('--ppm', default='0',
+		help='Comma separated list of USB clock offsets, in ppm')
+	parser.add_argument('--seeds', type=int, default=1,
+		help='Number of jitter seeds per point')
+	parser.add_argument('capture', nargs='+')
+	args = parser.parse_args()
+
+	jitters = [int(x) for x in args.jitter.split(',')]
+	ppms    = [int(x) for x in args.ppm.split(',')]
+
+	print("%-32s %7s %6s %8s %7s %7s %8s %8s %8s" % (
+		'Capture', 'Jitter', 'PPM', 'Packets', 'Errors', 'CRC', 'Adjust', 'Slips', 'Cyc/Pkt'))
+
+	ref = {}
+	fail = False
+
+	for cap in args.capture:
+		for ppm in ppms:
+			for jitter in jitters:
+				for seed in range(1, args.seeds + 1):
+					r = run(args.sim, cap, jitter, ppm, seed)
+
+					# First point of each capture is the reference, later
+					# ones must decode at least as many packets
+					key = cap
+					if key not in ref:
+						ref[key] = r['packets']
+					lost = ref[key] - r['packets']
+					if lost > 0:
+						fail = True
+
+					print("%-32s %7d %6d %8d %7d %7d %8d %8d %8d%s" % (
+						os.path.basename(cap)[-32:], jitter, ppm,
+						r['packets'], r['errors'], r['crc_errors'],
+						r['dpll_adjust'], r['dpll_slips'], r['cycles_per_pkt'],
+						'  (%d lost)' % lost if lost > 0 else ''))
+
+	return 1 if fail else 0
+
+
+if __name__ == '__main__':
+	sys.exit(main())
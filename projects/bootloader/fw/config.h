@@ -28,3 +28,11 @@
 #define USB_CORE_BASE	0x82000000
 #define USB_DATA_BASE	0x83000000
 #define SPI_BASE	0x84000000
+
+#define UART_CLK_FREQ	48000000	/* UART is in the USB clock domain */
+
+#ifndef CONSOLE_BAUDRATE
+#define CONSOLE_BAUDRATE	115200	/* Up to 3000000 */
+#endif
+
+#define USB_EP_BUF_SIZE	2048	/* Per direction, must match EP_AW of the core */
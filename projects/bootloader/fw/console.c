@@ -24,12 +24,15 @@
 #include <stdint.h>
 
 #include "config.h"
+#include "console.h"
 #include "mini-printf.h"
 
 
 struct wb_uart {
 	uint32_t data;
 	uint32_t clkdiv;
+	uint32_t irq;
+	uint32_t level;
 } __attribute__((packed,aligned(4)));
 
 static volatile struct wb_uart * const uart_regs = (void*)(UART_BASE);
@@ -39,7 +42,13 @@ static char _printf_buf[128];
 
 void console_init(void)
 {
-	uart_regs->clkdiv = 414;	/* 115200 baid with clk=48MHz */
+	console_set_baudrate(CONSOLE_BAUDRATE);
+}
+
+void console_set_baudrate(unsigned int baudrate)
+{
+	/* Bit time is (clkdiv + 2) clock cycles, rounded to the nearest */
+	uart_regs->clkdiv = ((UART_CLK_FREQ + (baudrate >> 1)) / baudrate) - 2;
 }
 
 char getchar(void)
@@ -24,6 +24,7 @@
 #pragma once
 
 void console_init(void);
+void console_set_baudrate(unsigned int baudrate);
 
 char getchar(void);
 int  getchar_nowait(void);
@@ -28,15 +28,20 @@
 #include "console.h"
 #include "misc.h"
 #include "mini-printf.h"
+#include "ovl.h"
 #include "spi.h"
 #include "usb.h"
 #include "usb_dfu.h"
+#ifdef USB_BENCH
+#include "usb_bench.h"
+#endif
 #include "utils.h"
 
 #include "config.h"
 
 
 extern const struct usb_stack_descriptors dfu_stack_desc;
+extern const struct usb_stack_descriptors dfu_stack_desc_wp;
 extern const uint8_t desc_ms_os_20[0x1E];
 
 
@@ -44,8 +49,6 @@ static void
 serial_no_init()
 {
 	uint8_t buf[8];
-	char *id, *desc;
-	int i;
 
 	flash_manuf_id(buf);
 	printf("Flash Manufacturer : %s\n", hexstr(buf, 3, true));
@@ -53,12 +56,8 @@ serial_no_init()
 	flash_unique_id(buf);
 	printf("Flash Unique ID    : %s\n", hexstr(buf, 8, true));
 
-	/* Overwrite descriptor string */
-		/* In theory in rodata ... but nothing is ro here */
-	id = hexstr(buf, 8, false);
-	desc = (char*)dfu_stack_desc.str[1];
-	for (i=0; i<16; i++)
-		desc[2 + (i << 1)] = id[i];
+	/* Use it as serial number */
+	usb_dfu_set_serial(hexstr(buf, 8, false));
 }
 
 void
@@ -98,6 +97,7 @@ void main()
 {
 	int cmd = 0;
 	bool do_dfu = false;
+	bool wp_bootloader;
 
 	/* Init console IO */
 	console_init();
@@ -122,13 +122,12 @@ void main()
 	delay(20); /* wait for stable BTN inputs before reading */
 
 	/* Should we expose the 'bootloader' section as writable? */
-	if ((btn_get() & BTN_START) == 0)
+	wp_bootloader = (btn_get() & BTN_START) == 0;
+
+	if (wp_bootloader)
 	{
 		/* 'bootloader' should be write protected */
-		/* soft protection */
-		/* We patch the descriptor length ... in RO section but not really RO */
-		struct usb_conf_desc *conf = (void*)dfu_stack_desc.conf[0];
-		conf->wTotalLength -= 18;
+		/* soft protection: descriptors without the 'protect' zones */
 		//printf("write protect bootloader\n");
 		#if 1
 		/* hard protection */
@@ -155,22 +154,28 @@ void main()
 	if (!do_dfu)
 		reboot_now();
 
-	/* LCD */
-	#if 0
-	lcd_init();
-	lcd_show_logo();
-	lcd_on();
+	/* LCD (the logo may be in the DFU buffers, draw it before USB) */
+#ifdef HAS_LCD
+	if (ovl_load(OVL_LCD)) {
+		lcd_init();
+		lcd_show_logo();
+		lcd_progress_init(40, 286, 400, 14);	/* DFU progress bar stays off without it */
+		lcd_on();
 
-	led_on(LCD_BACKLIGHT);
-	led_set_pwm(LCD_BACKLIGHT, 1);
-	#endif
+		led_on(LCD_BACKLIGHT);
+		led_set_pwm(LCD_BACKLIGHT, 1);
+	}
+#endif
 
 	/* Enable USB */
 	serial_no_init();
 
-	usb_init(&dfu_stack_desc);
+	usb_init(wp_bootloader ? &dfu_stack_desc_wp : &dfu_stack_desc);
 	usb_dfu_init();
 	usb_register_function_driver(&_ms_os_20_drv);
+#ifdef USB_BENCH
+	usb_bench_init();
+#endif
 	usb_connect();
 
 	/* Main loop */
@@ -193,7 +198,8 @@ void main()
 			switch (cmd)
 			{
 			case 'p':
-				usb_debug_print();
+				if (ovl_load(OVL_DEBUG))
+					usb_debug_print();
 				break;
 			case 'c':
 				usb_connect();
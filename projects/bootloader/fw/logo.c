@@ -730,3 +730,5 @@ const uint8_t lcd_logo[] = {
 	0xf0, 0xff, 0xce, 0x00, 0x05, 0x07, 0x05, 0xf0, 0xff, 0xcf, 0x00, 0x05, 0xf0, 0xff, 0x30, 0x1b,
 };
 
+
+const unsigned int lcd_logo_len = sizeof(lcd_logo);
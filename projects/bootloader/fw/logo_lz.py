@@ -0,0 +1,86 @@
+#!/usr/bin/env python3
+
+#
+# Compresses the lcd_logo[] RLE stream of logo.c with a small LZSS so it
+# can be kept in the scratch area (see lnk-app.lds) until it's drawn.
+#
+# Usage: logo_lz.py logo.c output.gen.c
+#
+# Format, decoded by lcd_blit_lz() in misc.c :
+#
+#  - A flag byte, then the 8 items it describes, LSB first
+#  - Flag 0 : one literal byte
+#  - Flag 1 : two bytes, distance - 1 (1..256) and length - 3 (3..258),
+#             copied from the already decoded output (256 bytes window)
+#
+
+import re
+import sys
+
+
+WIN_SIZE = 256
+LEN_MIN  = 3
+LEN_MAX  = 258
+
+
+def lz_compress(data):
+	items = []
+	i = 0
+
+	while i < len(data):
+		# Longest match in the window, overlap allowed
+		best_len, best_dist = 0, 0
+		for j in range(max(0, i - WIN_SIZE), i):
+			l = 0
+			while (i + l < len(data)) and (l < LEN_MAX) and (data[j + l] == data[i + l]):
+				l += 1
+			if l >= best_len:
+				best_len, best_dist = l, i - j
+
+		if best_len >= LEN_MIN:
+			items.append((best_dist, best_len))
+			i += best_len
+		else:
+			items.append(data[i])
+			i += 1
+
+	out = bytearray()
+	for k in range(0, len(items), 8):
+		flags = 0
+		body = bytearray()
+		for n, it in enumerate(items[k:k+8]):
+			if isinstance(it, tuple):
+				flags |= 1 << n
+				body += bytes([it[0] - 1, it[1] - LEN_MIN])
+			else:
+				body.append(it)
+		out.append(flags)
+		out += body
+
+	n_match = sum(isinstance(it, tuple) for it in items)
+	return out, n_match, len(items) - n_match
+
+
+def main(argv0, in_name, out_name):
+	with open(in_name, 'r') as fh:
+		src = fh.read()
+
+	data = bytes(int(x, 16) for x in re.findall(r'0x([0-9a-fA-F]{2})', src))
+	lz, n_match, n_lit = lz_compress(data)
+
+	with open(out_name, 'w') as fh:
+		fh.write('/* Generated by logo_lz.py from %s, do not edit */\n\n' % in_name)
+		fh.write('#include <stdint.h>\n\n')
+		fh.write('/* In the DFU buffers, only valid until usb_dfu_init() */\n')
+		fh.write('const uint8_t lcd_logo_lz[] __attribute__((section(".scratch"))) = {\n')
+		for i in range(0, len(lz), 16):
+			fh.write('\t' + ' '.join('0x%02x,' % b for b in lz[i:i+16]) + '\n')
+		fh.write('};\n\n')
+		fh.write('const unsigned int lcd_logo_len = %d;\n' % len(data))
+
+	sys.stderr.write('logo: %d -> %d bytes (%d matches, %d literals)\n' % (
+		len(data), len(lz), n_match, n_lit))
+
+
+if __name__ == '__main__':
+	main(*sys.argv)
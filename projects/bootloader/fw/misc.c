@@ -25,6 +25,7 @@
 
 #include "config.h"
 #include "misc.h"
+#include "ovl.h"
 
 
 struct had_misc {
@@ -32,6 +33,9 @@ struct had_misc {
 	uint32_t pwm;
 	uint32_t lcd_cmd;
 	uint32_t lcd_data;
+	uint32_t blit_data;
+	uint32_t blit_pal;
+	uint32_t blit_ctrl;
 } __attribute__((packed,aligned(4)));
 
 static volatile struct had_misc * const had_misc_regs = (void*)(HAD_MISC_BASE);
@@ -55,6 +59,13 @@ flashchip_select(int flash_sel)
 	had_misc_regs->ctrl = v;
 }
 
+int
+flashchip_selected(void)
+{
+	// The flipflop data bit reads back as what was last clocked in
+	return (had_misc_regs->ctrl & (1<<13)) ? FLASHCHIP_CART : FLASHCHIP_INTERNAL;
+}
+
 
 // ---------------------------------------------------------------------------
 // Buttons
@@ -114,7 +125,7 @@ void delay(int n) {
 }
 
 
-static const uint8_t lcd_init_data[] = {
+static const uint8_t lcd_init_data[] OVL_RODATA(lcd) = {
 	0x02, 0xF0, 0x5A, 0x5A,
 	0x02, 0xF1, 0x5A, 0x5A,
 	0x13, 0xF2, 0x3B, 0x40, 0x03, 0x04, 0x02, 0x08, 0x08, 0x00, 0x08, 0x08, 0x00, 0x00, 0x00, 0x00, 0x40, 0x08, 0x08, 0x08, 0x08,
@@ -134,7 +145,8 @@ static const uint8_t lcd_init_data[] = {
 	0xff		/* End */
 };
 
-void lcd_init()
+void OVL_TEXT(lcd)
+lcd_init(void)
 {
 	const uint8_t *p = lcd_init_data;
 	int n=0;
@@ -178,9 +190,96 @@ lcd_off(void)
 }
 
 
+#ifdef LOGO_LZ
+extern const uint8_t lcd_logo_lz[];
+#else
 extern const uint8_t lcd_logo[];
+#endif
+extern const unsigned int lcd_logo_len;
+
+void
+lcd_blit_palette(const uint32_t *pal, int n)
+{
+	for (int i=0; i<n; i++)
+		had_misc_regs->blit_pal = (i << 28) | pal[i];
+}
+
+void
+lcd_blit_rle(const uint8_t *p, unsigned int len, unsigned int n_pixels)
+{
+	uint32_t w;
+
+	/* Start, the stream needs to come after */
+	had_misc_regs->blit_ctrl = n_pixels;
+
+	/* Feed it (the bus stalls when the FIFO is full) */
+	while (len) {
+		w = 0;
+		for (int i=0; i<4 && len; i++, len--)
+			w |= *p++ << (8*i);
+		had_misc_regs->blit_data = w;
+	}
+}
 
-void lcd_show_logo()
+#ifdef LOGO_LZ
+/* Decodes a logo_lz.py stream and feeds the result to the blitter */
+static void OVL_TEXT(lcd)
+lcd_blit_lz(const uint8_t *p, unsigned int len, unsigned int n_pixels)
+{
+	uint8_t win[256];
+	uint8_t wp = 0;
+	uint8_t c;
+	uint32_t w = 0;
+	unsigned int wb = 0;
+	unsigned int flags = 1;
+	unsigned int dist = 0, cnt = 0;
+
+	/* Start, the stream needs to come after */
+	had_misc_regs->blit_ctrl = n_pixels;
+
+	/* One output byte per iteration */
+	while (len--) {
+		if (!cnt) {
+			if (flags == 1)
+				flags = *p++ | 0x100;
+
+			if (flags & 1) {
+				dist = p[0] + 1;
+				cnt  = p[1] + 3;
+				p += 2;
+			} else {
+				dist = 0;
+				cnt  = 1;
+			}
+
+			flags >>= 1;
+		}
+
+		c = dist ? win[(uint8_t)(wp - dist)] : *p++;
+		win[wp++] = c;
+		cnt--;
+
+		w |= c << wb;
+		wb += 8;
+		if (wb == 32) {
+			had_misc_regs->blit_data = w;
+			w = wb = 0;
+		}
+	}
+
+	if (wb)
+		had_misc_regs->blit_data = w;
+}
+#endif
+
+bool
+lcd_blit_busy(void)
+{
+	return (had_misc_regs->blit_ctrl & (1 << 31)) != 0;
+}
+
+void OVL_TEXT(lcd)
+lcd_show_logo(void)
 {
 	#define RGB(r,g,b) (\
 		( ((r) >> 3) << 11 ) | \
@@ -188,7 +287,7 @@ void lcd_show_logo()
 		( ((b) >> 3) <<  0 ) \
 	)
 
-	const uint32_t pal[] = {
+	static const uint32_t pal[] OVL_RODATA(lcd) = {
 		RGB(  0,  0,  0),
 		RGB(  5,  5, 38),
 		RGB(  9,  9, 70),
@@ -197,46 +296,153 @@ void lcd_show_logo()
 		RGB(152,152,152),
 		RGB(255,255,140),
 		RGB(255,255,255),
-		   0,
-		   0,
-		   0,
-		   0,
-		   0,
-		   0,
-		   0,
-		   0,
 	};
-	const uint8_t *p = lcd_logo;
-	uint8_t c;
-	int n;
 
 	/* Start draw */
 	had_misc_regs->lcd_cmd = 0x2c;
 
-	for (int i=0; i<320*480;) {
-		/* Get command */
-		c = *p++;
+	/* Decoded and drawn by the blitter in soc_had_misc */
+	lcd_blit_palette(pal, sizeof(pal) / sizeof(pal[0]));
+#ifdef LOGO_LZ
+	lcd_blit_lz(lcd_logo_lz, lcd_logo_len, 320*480);
+#else
+	lcd_blit_rle(lcd_logo, lcd_logo_len, 320*480);
+#endif
 
-		/* Repeat count */
-		n = c >> 4;
-		if (n == 0xf) {
-			n = *p++;
-			if (n == 0xff) {
-				n = *p++;
-				n |= (*p++) << 8;
-				n += 271;
-			} else {
-				n += 16;
-			}
+	while (lcd_blit_busy());
+}
+
+
+// ---------------------------------------------------------------------------
+// LCD progress bar
+// ---------------------------------------------------------------------------
+
+/* Palette entries used, above the ones of the logo */
+#define PB_PAL_FRAME	8
+#define PB_PAL_BG	9
+#define PB_PAL_FG	10
+
+static struct {
+	int x, y, w, h;		/* Inner area */
+	int drawn;		/* Current width of the filled part */
+} g_pb;
+
+static void
+lcd_window(int x, int y, int w, int h)
+{
+	int xe = x + w - 1;
+	int ye = y + h - 1;
+
+	/* Column address set */
+	had_misc_regs->lcd_cmd  = 0x2a;
+	had_misc_regs->lcd_data = x >> 8;
+	had_misc_regs->lcd_data = x & 0xff;
+	had_misc_regs->lcd_data = xe >> 8;
+	had_misc_regs->lcd_data = xe & 0xff;
+
+	/* Page address set */
+	had_misc_regs->lcd_cmd  = 0x2b;
+	had_misc_regs->lcd_data = y >> 8;
+	had_misc_regs->lcd_data = y & 0xff;
+	had_misc_regs->lcd_data = ye >> 8;
+	had_misc_regs->lcd_data = ye & 0xff;
+
+	/* Memory write */
+	had_misc_regs->lcd_cmd  = 0x2c;
+}
+
+void
+lcd_fill_rect(int x, int y, int w, int h, int pal_idx)
+{
+	uint8_t rle[12];
+	unsigned int n = w * h;
+	unsigned int c, l = 0;
+
+	if (!n)
+		return;
+
+	/* The LCD bus is the blitter's until it's done */
+	while (lcd_blit_busy());
+
+	lcd_window(x, y, w, h);
+
+	/* Single colour runs, 3 long ones are enough for the whole screen */
+	while (n && (l <= sizeof(rle) - 4)) {
+		c = (n > 65806) ? 65806 : n;
+		if (c <= 15) {
+			rle[l++] = ((c - 1) << 4) | pal_idx;
+		} else if (c <= 270) {
+			rle[l++] = 0xf0 | pal_idx;
+			rle[l++] = c - 16;
 		} else {
-			n += 1;
+			rle[l++] = 0xf0 | pal_idx;
+			rle[l++] = 0xff;
+			rle[l++] = (c - 271) & 0xff;
+			rle[l++] = (c - 271) >> 8;
 		}
+		n -= c;
+	}
 
-		/* Write */
-		while (n--) {
-			c &= 0xf;
-			had_misc_regs->lcd_data = pal[c];
-			i++;
-		}
+	lcd_blit_rle(rle, l, w * h - n);
+}
+
+void
+lcd_progress_init(int x, int y, int w, int h)
+{
+	static const uint32_t pal[] = {
+		RGB(255,255,255),	/* PB_PAL_FRAME */
+		RGB(  5,  5, 38),	/* PB_PAL_BG */
+		RGB(255,255,140),	/* PB_PAL_FG */
+	};
+
+	for (int i=0; i<3; i++)
+		had_misc_regs->blit_pal = ((PB_PAL_FRAME + i) << 28) | pal[i];
+
+	/* Frame and empty bar, drawn once */
+	lcd_fill_rect(x, y, w, h, PB_PAL_FRAME);
+	lcd_fill_rect(x + 1, y + 1, w - 2, h - 2, PB_PAL_BG);
+
+	g_pb.x = x + 1;
+	g_pb.y = y + 1;
+	g_pb.w = w - 2;
+	g_pb.h = h - 2;
+	g_pb.drawn = 0;
+}
+
+bool
+lcd_progress_update(uint32_t num, uint32_t den)
+{
+	int tgt;
+
+	/* Not initialized */
+	if (!g_pb.w)
+		return true;
+
+	if (num > den)
+		num = den;
+
+	/* Keep num * w in 32 bits */
+	while (den >= (1 << 22)) {
+		num >>= 1;
+		den >>= 1;
 	}
+
+	tgt = den ? (num * g_pb.w) / den : 0;
+
+	if (tgt == g_pb.drawn)
+		return true;
+
+	/* Never wait, the caller will retry */
+	if (lcd_blit_busy())
+		return false;
+
+	/* Only redraw the columns that changed */
+	if (tgt > g_pb.drawn)
+		lcd_fill_rect(g_pb.x + g_pb.drawn, g_pb.y, tgt - g_pb.drawn, g_pb.h, PB_PAL_FG);
+	else
+		lcd_fill_rect(g_pb.x + tgt, g_pb.y, g_pb.drawn - tgt, g_pb.h, PB_PAL_BG);
+
+	g_pb.drawn = tgt;
+
+	return true;
 }
@@ -23,6 +23,9 @@
 
 #pragma once
 
+#include <stdbool.h>
+#include <stdint.h>
+
 #define BTN_UP		(1 << 0)
 #define BTN_DOWN	(1 << 1)
 #define BTN_LEFT	(1 << 2)
@@ -38,6 +41,7 @@
 #define FLASHCHIP_CART 1
 
 void flashchip_select(int flash_sel);
+int  flashchip_selected(void);
 
 uint32_t btn_get(void);
 
@@ -52,3 +56,11 @@ void lcd_init(void);
 void lcd_on(void);
 void lcd_off(void);
 void lcd_show_logo(void);
+
+void lcd_blit_palette(const uint32_t *pal, int n);
+void lcd_blit_rle(const uint8_t *p, unsigned int len, unsigned int n_pixels);
+bool lcd_blit_busy(void);
+
+void lcd_fill_rect(int x, int y, int w, int h, int pal_idx);
+void lcd_progress_init(int x, int y, int w, int h);
+bool lcd_progress_update(uint32_t num, uint32_t den);
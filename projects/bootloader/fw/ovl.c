@@ -0,0 +1,93 @@
+/*
+ * ovl.c
+ *
+ * Flash overlays loader
+ *
+ * Copyright (C) 2019 Sylvain Munaut
+ * All rights reserved.
+ *
+ * LGPL v3+, see LICENSE.lgpl3
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "console.h"
+#include "misc.h"
+#include "ovl.h"
+#include "spi.h"
+
+
+#ifdef HAS_OVL
+
+/* Linker provided, see lnk-app.lds */
+extern uint32_t _ovl_window[];
+extern const char _ovl_build_id[];
+
+extern const char __load_start_ovl_lcd[],   __load_stop_ovl_lcd[];
+extern const char __load_start_ovl_debug[], __load_stop_ovl_debug[];
+
+/* Flash addresses (the load addresses are the flash ones) */
+static const struct {
+	const char *start;
+	const char *stop;
+} ovl_tab[_OVL_MAX] = {
+	[OVL_LCD]   = { __load_start_ovl_lcd,   __load_stop_ovl_lcd   },
+	[OVL_DEBUG] = { __load_start_ovl_debug, __load_stop_ovl_debug },
+};
+
+static int g_ovl_cur = -1;
+
+bool
+ovl_load(enum ovl_id id)
+{
+	/* Already there ? */
+	if (g_ovl_cur == (int)id)
+		return true;
+
+	g_ovl_cur = -1;
+
+	/* Overlays are in the internal flash, wait for any pending write */
+	int sel = flashchip_selected();
+
+	flashchip_select(FLASHCHIP_INTERNAL);
+	while (flash_read_sr() & 1);
+
+	flash_read(_ovl_window, (uint32_t)ovl_tab[id].start, ovl_tab[id].stop - ovl_tab[id].start);
+
+	flashchip_select(sel);
+
+	/* Check it's from this build and not some leftover (or nothing) */
+	if (_ovl_window[0] != (uint32_t)_ovl_build_id) {
+		printf("Overlay %d not from this build, skipped\n", id);
+		return false;
+	}
+
+	g_ovl_cur = id;
+
+	return true;
+}
+
+#else
+
+bool
+ovl_load(enum ovl_id id)
+{
+	return true;
+}
+
+#endif
@@ -0,0 +1,48 @@
+/*
+ * ovl.h
+ *
+ * Copyright (C) 2019 Sylvain Munaut
+ * All rights reserved.
+ *
+ * LGPL v3+, see LICENSE.lgpl3
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+
+/*
+ * Rarely used code can be put in flash overlays (see lnk-app.lds), they
+ * share a single RAM window and ovl_load() must be called before calling
+ * anything in them. Without HAS_OVL, everything is resident.
+ */
+
+enum ovl_id {
+	OVL_LCD = 0,
+	OVL_DEBUG,
+	_OVL_MAX
+};
+
+#ifdef HAS_OVL
+#define OVL_TEXT(name)		__attribute__((noinline,noclone,section(".ovl_" #name ".text")))
+#define OVL_RODATA(name)	__attribute__((section(".ovl_" #name ".rodata")))
+#else
+#define OVL_TEXT(name)
+#define OVL_RODATA(name)
+#endif
+
+bool ovl_load(enum ovl_id id);
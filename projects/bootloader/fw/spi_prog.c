@@ -0,0 +1,200 @@
+/*
+ * spi_prog.c
+ *
+ * Interpreter for the SPI_PROG vendor request programs, see the format
+ * in usb_dfu_vendor.h
+ *
+ * Copyright (C) 2019 Sylvain Munaut
+ * All rights reserved.
+ *
+ * LGPL v3+, see LICENSE.lgpl3
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <stdint.h>
+
+#include "spi_prog.h"
+#include "usb_dfu_vendor.h"
+
+
+/* WAIT gives up after that many polls (a few seconds) */
+#define WAIT_MAX_POLLS	(1 << 22)
+
+
+static uint32_t
+_get_le(const uint8_t *p, int n)
+{
+	uint32_t v = 0;
+	while (n--)
+		v = (v << 8) | p[n];
+	return v;
+}
+
+uint8_t
+spi_prog_run(const struct spi_prog_ops *ops, uint8_t *buf, unsigned int len)
+{
+	struct {
+		unsigned int pc;
+		unsigned int left;
+	} loop[DFU_SPI_LOOP_DEPTH];
+	unsigned int pc = DFU_SPI_PROG_HDR;
+	unsigned int op_pc = pc;
+	unsigned int cs = 0, dp = 0, depth = 0;
+	unsigned int n, i;
+	uint32_t addr = 0;
+	uint8_t st = DFU_SPI_ST_OK;
+	uint8_t op, tmp[4];
+
+	/* Arguments of the current opcode */
+	#define NEED(x) if (pc + (x) > len) { st = DFU_SPI_ST_BOUNDS; break; }
+
+	while (1) {
+		op_pc = pc;
+
+		/* Programs must end with END */
+		if (pc >= len) {
+			st = DFU_SPI_ST_BOUNDS;
+			break;
+		}
+
+		op = buf[pc++];
+
+		if (op == DFU_SPI_OP_END)
+			break;
+
+		switch (op)
+		{
+		case DFU_SPI_OP_CS:
+			NEED(1);
+			cs = buf[pc++];
+			if (cs > 2)
+				st = DFU_SPI_ST_BAD_OP;
+			break;
+
+		case DFU_SPI_OP_FLASH:
+			NEED(1);
+			if (buf[pc] > 1)
+				st = DFU_SPI_ST_BAD_OP;
+			else
+				ops->flash_sel(buf[pc]);
+			pc++;
+			break;
+
+		case DFU_SPI_OP_XFER:
+			NEED(2);
+			n = _get_le(&buf[pc], 2);
+			pc += 2;
+			NEED(n);
+			ops->xfer(cs, &buf[pc], n, 0, 0);
+			pc += n;
+			break;
+
+		case DFU_SPI_OP_XFER_A:
+			NEED(3);
+			n = _get_le(&buf[pc+1], 2);
+			if (dp + n > len) {
+				st = DFU_SPI_ST_BOUNDS;
+				break;
+			}
+			tmp[0] = buf[pc];
+			tmp[1] = addr >> 16;
+			tmp[2] = addr >>  8;
+			tmp[3] = addr;
+			ops->xfer(cs, tmp, 4, &buf[dp], n);
+			dp += n;
+			pc += 3;
+			break;
+
+		case DFU_SPI_OP_WAIT:
+			NEED(2);
+			for (i=0; ; i++) {
+				tmp[0] = buf[pc];
+				tmp[1] = 0x00;
+				ops->xfer(cs, tmp, 2, 0, 0);
+				if (!(tmp[1] & buf[pc+1]))
+					break;
+				if (i == WAIT_MAX_POLLS) {
+					st = DFU_SPI_ST_TIMEOUT;
+					break;
+				}
+			}
+			pc += 2;
+			break;
+
+		case DFU_SPI_OP_ADDR:
+			NEED(4);
+			addr = _get_le(&buf[pc], 4);
+			pc += 4;
+			break;
+
+		case DFU_SPI_OP_ADDR_ADD:
+			NEED(4);
+			addr += _get_le(&buf[pc], 4);
+			pc += 4;
+			break;
+
+		case DFU_SPI_OP_DATA:
+			NEED(2);
+			dp = _get_le(&buf[pc], 2);
+			pc += 2;
+			break;
+
+		case DFU_SPI_OP_LOOP:
+			NEED(2);
+			n = _get_le(&buf[pc], 2);
+			pc += 2;
+			if ((depth == DFU_SPI_LOOP_DEPTH) || !n) {
+				st = DFU_SPI_ST_LOOP;
+				break;
+			}
+			loop[depth].pc   = pc;
+			loop[depth].left = n;
+			depth++;
+			break;
+
+		case DFU_SPI_OP_ENDLOOP:
+			if (!depth)
+				st = DFU_SPI_ST_LOOP;
+			else if (--loop[depth-1].left)
+				pc = loop[depth-1].pc;
+			else
+				depth--;
+			break;
+
+		default:
+			st = DFU_SPI_ST_BAD_OP;
+			break;
+		}
+
+		if (st)
+			break;
+	}
+
+	#undef NEED
+
+	if (!st && depth)
+		st = DFU_SPI_ST_LOOP;
+
+	/* Status for the host */
+	if (len >= DFU_SPI_PROG_HDR) {
+		buf[0] = st;
+		buf[1] = 0;
+		buf[2] = op_pc;
+		buf[3] = op_pc >> 8;
+	}
+
+	return st;
+}
@@ -0,0 +1,37 @@
+/*
+ * spi_prog.h
+ *
+ * Interpreter for the SPI_PROG vendor request programs
+ *
+ * Copyright (C) 2019 Sylvain Munaut
+ * All rights reserved.
+ *
+ * LGPL v3+, see LICENSE.lgpl3
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+/* Also built in the host tools (emulated flash), so no direct hw access */
+struct spi_prog_ops {
+	/* One CS framed full duplex transfer of hdr then data */
+	void (*xfer)(unsigned cs, uint8_t *hdr, unsigned hdr_len, uint8_t *data, unsigned len);
+	void (*flash_sel)(int sel);
+};
+
+uint8_t spi_prog_run(const struct spi_prog_ops *ops, uint8_t *buf, unsigned int len);
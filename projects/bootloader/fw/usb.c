@@ -26,6 +26,7 @@
 #include <string.h>
 
 #include "console.h"
+#include "ovl.h"
 #include "usb_hw.h"
 #include "usb_priv.h"
 #include "usb.h"
@@ -62,6 +63,20 @@ usb_data_read (void *dst, unsigned int src_ofs, int len)
 
 	int i = len >> 2;
 
+	/* Unaligned destination (e.g. DFU blocks appended at any offset),
+	 * the CPU would round word stores down, so use byte stores */
+	if ((uintptr_t)dst & 3) {
+		uint8_t *dst_u8 = dst;
+		while (len > 0) {
+			uint32_t x = *src_u32++;
+			for (i=0; (i<4) && (len>0); i++, len--) {
+				*dst_u8++ = x & 0xff;
+				x >>= 8;
+			}
+		}
+		return;
+	}
+
 	while (i--)
 		*dst_u32++ = *src_u32++;
 
@@ -256,7 +271,7 @@ usb_dispatch_get_intf(const struct usb_intf_desc *base, uint8_t *sel)
 /* Debug */
 /* ----- */
 
-static void
+static void OVL_TEXT(debug)
 _fast_print_hex(uint32_t v)
 {
 	const char _hex[] = "0123456789abcdef";
@@ -270,7 +285,7 @@ _fast_print_hex(uint32_t v)
 	}
 }
 
-void
+void OVL_TEXT(debug)
 usb_debug_print_ep(int ep, int dir)
 {
 	volatile struct usb_ep *ep_regs = dir ? &usb_ep_regs[ep].in : &usb_ep_regs[ep].out;
@@ -284,7 +299,7 @@ usb_debug_print_ep(int ep, int dir)
 	printf("\n");
 }
 
-void
+void OVL_TEXT(debug)
 usb_debug_print_data(int ofs, int len)
 {
 	volatile uint32_t *data = (volatile uint32_t *)((USB_DATA_BASE) + (ofs << 2));
@@ -297,7 +312,7 @@ usb_debug_print_data(int ofs, int len)
 	puts("\n");
 }
 
-void
+void OVL_TEXT(debug)
 usb_debug_print(void)
 {
 	printf("Stack:\n");
@@ -351,6 +366,9 @@ usb_bus_reset(void)
 	/* Reset EP0 */
 	usb_ep0_reset();
 
+	/* Drop any pending transfer */
+	memset(g_usb.ep, 0x00, sizeof(g_usb.ep));
+
 	/* Dispatch event */
 	usb_dipatch_bus_reset();
 
@@ -358,6 +376,108 @@ usb_bus_reset(void)
 	usb_set_state(USB_DS_DEFAULT);
 }
 
+void
+usb_ep_alloc(const struct usb_conf_desc *conf)
+{
+	static const uint16_t ep_types[4] = {
+		USB_EP_TYPE_CTRL, USB_EP_TYPE_ISOC, USB_EP_TYPE_BULK, USB_EP_TYPE_INT,
+	};
+	static const uint16_t dual_prio[3] = {
+		USB_EP_TYPE_BULK, USB_EP_TYPE_ISOC, USB_EP_TYPE_INT,
+	};
+	struct {
+		uint16_t type;
+		uint16_t size;
+		uint16_t ptr[2];
+	} eps[2][15];
+	unsigned int nxt[2];
+	const void *sod, *eod;
+	int d, i, p;
+
+	/* Release all non-control EPs */
+	for (i=1; i<16; i++) {
+		_usb_hw_reset_ep(&usb_ep_regs[i].out);
+		_usb_hw_reset_ep(&usb_ep_regs[i].in);
+	}
+
+	memset(g_usb.ep, 0x00, sizeof(g_usb.ep));
+
+	if (!conf)
+		return;
+
+	/* Collect the largest packet size of each EP, across all the
+	 * alternate settings so SET_INTERFACE never needs to re-allocate */
+	memset(eps, 0x00, sizeof(eps));
+
+	sod = conf;
+	eod = sod + conf->wTotalLength;
+
+	while ((sod = usb_desc_find(sod, eod, USB_DT_EP)) != NULL) {
+		const struct usb_ep_desc *epd = sod;
+		d = (epd->bEndpointAddress & 0x80) ? 1 : 0;
+		i = (epd->bEndpointAddress & 0xf) - 1;
+
+		if (i >= 0) {
+			/* Buffers are word aligned for usb_data_{read,write} */
+			uint16_t size = ((epd->wMaxPacketSize & 0x3ff) + 3) & ~3;
+
+			eps[d][i].type = ep_types[epd->bmAttributes & 3];
+			if (size > eps[d][i].size)
+				eps[d][i].size = size;
+			if ((epd->wMaxPacketSize & 0x3ff) > g_usb.ep[d][i].mps)
+				g_usb.ep[d][i].mps = epd->wMaxPacketSize & 0x3ff;
+		}
+
+		sod = usb_desc_next(sod);
+	}
+
+	/* EP0 sits at the start of each memory (IN / OUT+SETUP) */
+	nxt[0] = 2 * EP0_PKT_LEN;
+	nxt[1] = EP0_PKT_LEN;
+
+	/* First pass : one buffer for every EP */
+	for (d=0; d<2; d++)
+		for (i=0; i<15; i++) {
+			if (!eps[d][i].size)
+				continue;
+
+			if ((nxt[d] + eps[d][i].size) > USB_EP_BUF_SIZE) {
+				USB_LOG_ERR("[!] No buffer space for EP%d %s\n", i+1, d ? "IN" : "OUT");
+				eps[d][i].type = USB_EP_TYPE_NONE;
+				continue;
+			}
+
+			eps[d][i].ptr[0] = nxt[d];
+			nxt[d] += eps[d][i].size;
+		}
+
+	/* Second pass : use what's left to double buffer, throughput
+	 * oriented EPs first. Control EPs are always single buffered */
+	for (p=0; p<3; p++)
+		for (d=0; d<2; d++)
+			for (i=0; i<15; i++) {
+				if ((eps[d][i].type != dual_prio[p]) ||
+				    ((nxt[d] + eps[d][i].size) > USB_EP_BUF_SIZE))
+					continue;
+
+				eps[d][i].ptr[1] = nxt[d];
+				nxt[d] += eps[d][i].size;
+			}
+
+	/* Program the EPs */
+	for (d=0; d<2; d++)
+		for (i=0; i<15; i++) {
+			volatile struct usb_ep *epr = d ? &usb_ep_regs[i+1].in : &usb_ep_regs[i+1].out;
+
+			if (eps[d][i].type == USB_EP_TYPE_NONE)
+				continue;
+
+			epr->bd[0].ptr = eps[d][i].ptr[0];
+			epr->bd[1].ptr = eps[d][i].ptr[1];
+			epr->status = eps[d][i].type | (eps[d][i].ptr[1] ? USB_EP_BD_DUAL : 0);
+		}
+}
+
 
 /* Exposed API */
 /* ----------- */
@@ -421,12 +541,19 @@ usb_poll(void)
 	_dfu_tick();
 
 	/* Check for activity */
-	if (!(csr & USB_CSR_EVT_PENDING))
+	if (!(csr & USB_CSR_EVT_PENDING)) {
+		/* Control data stage might be waiting for buffer space */
+		if (g_usb.ctrl.data_wait)
+			usb_ep0_poll();
 		return;
+	}
 	csr = usb_regs->evt;
 
 	/* Poll EP0 (control) */
 	usb_ep0_poll();
+
+	/* Poll other EPs transfers */
+	usb_ep_poll();
 }
 
 void
@@ -560,3 +687,226 @@ usb_ep_resume(uint8_t ep)
 	epr->status = s & ~(USB_EP_TYPE_HALTED | USB_EP_DT_BIT); /* DT bit clear needed by CLEAR_FEATURE */
 	return true;
 }
+
+
+	/* Transfers on non-control EPs */
+
+static struct usb_ep_state *
+_get_ep_state(uint8_t ep)
+{
+	if (!(ep & 0xf))
+		return NULL;
+	return &g_usb.ep[(ep & 0x80) ? 1 : 0][(ep & 0xf) - 1];
+}
+
+static void
+_usb_ep_fill(volatile struct usb_ep *epr, struct usb_ep_state *eps, bool in)
+{
+	struct usb_xfer *xfer = eps->xfer;
+
+	while ((eps->n_queued < eps->n_bd) && ((eps->ofs_fill < xfer->len) || eps->zlp))
+	{
+		int bdi = eps->bdi_fill;
+		int len = xfer->len - eps->ofs_fill;
+
+		if (len >= eps->mps)
+			len = eps->mps;
+		else
+			eps->zlp = false;	/* Short packet ends the transfer */
+
+		if (in) {
+			if (len)
+				usb_data_write(epr->bd[bdi].ptr, &xfer->data[eps->ofs_fill], len);
+			epr->bd[bdi].csr = USB_BD_STATE_RDY_DATA | USB_BD_LEN(len);
+		} else {
+			/* Always allow a full packet, overflow is checked on RX */
+			epr->bd[bdi].csr = USB_BD_STATE_RDY_DATA | USB_BD_LEN(eps->mps);
+		}
+
+		eps->len[bdi] = len;
+		eps->ofs_fill += len;
+		eps->n_queued++;
+		eps->bdi_fill ^= (eps->n_bd - 1);
+	}
+}
+
+static void
+_usb_ep_flush(volatile struct usb_ep *epr, struct usb_ep_state *eps, bool in)
+{
+	int bdi = eps->bdi_done;
+	int n_kept = 0;
+
+	/* Take back the BDs still owned by the hardware. It only moves to
+	 * its next BD when one completes, so armed ones are just disarmed
+	 * in place. Completed ones are a prefix : OUT packets there were
+	 * already ACKed to the host and are kept for the next transfer */
+	for (; eps->n_queued; eps->n_queued--, bdi ^= (eps->n_bd - 1))
+	{
+		uint32_t state = epr->bd[bdi].csr & USB_BD_STATE_MSK;
+
+		if ((state != USB_BD_STATE_DONE_OK) && (state != USB_BD_STATE_DONE_ERR)) {
+			epr->bd[bdi].csr = 0;
+		} else if (!in) {
+			eps->len[bdi] = eps->mps;
+			n_kept++;
+		} else {
+			epr->bd[bdi].csr = 0;
+			eps->bdi_done = bdi ^ (eps->n_bd - 1);
+		}
+	}
+
+	eps->n_queued = n_kept;
+	eps->bdi_fill = (n_kept & 1) ? (eps->bdi_done ^ (eps->n_bd - 1)) : eps->bdi_done;
+}
+
+static void
+_usb_ep_poll_one(volatile struct usb_ep *epr, struct usb_ep_state *eps, bool in)
+{
+	struct usb_xfer *xfer = eps->xfer;
+	bool done = false;
+
+	/* Process completed BDs, in order */
+	while (eps->n_queued && !done)
+	{
+		int bdi = eps->bdi_done;
+		uint32_t csr = epr->bd[bdi].csr;
+
+		if ((csr & USB_BD_STATE_MSK) == USB_BD_STATE_DONE_OK) {
+			if (in) {
+				xfer->ofs += eps->len[bdi];
+			} else {
+				int len = (csr & USB_BD_LEN_MSK) - 2;
+				int room = xfer->len - xfer->ofs;
+
+				if (len > room) {
+					USB_LOG_ERR("[!] Overflow on EP%d OUT\n", (int)(eps - g_usb.ep[0]) + 1);
+					len = room;
+					done = true;
+				}
+
+				if (len)
+					usb_data_read(&xfer->data[xfer->ofs], epr->bd[bdi].ptr, len);
+				xfer->ofs += len;
+
+				/* Short packet or buffer full ends the transfer */
+				if ((len < eps->mps) || (xfer->ofs == xfer->len))
+					done = true;
+			}
+		} else if ((csr & USB_BD_STATE_MSK) == USB_BD_STATE_DONE_ERR) {
+			/* RX error, host will retry, just give the space back */
+			eps->ofs_fill -= eps->len[bdi];
+		} else {
+			break;
+		}
+
+		epr->bd[bdi].csr = 0;
+		eps->bdi_done ^= (eps->n_bd - 1);
+		eps->n_queued--;
+	}
+
+	/* IN transfers are done when everything is ACKed */
+	if (in && !eps->n_queued && (eps->ofs_fill == xfer->len) && !eps->zlp)
+		done = true;
+
+	if (done) {
+		_usb_ep_flush(epr, eps, in);
+		eps->xfer = NULL;
+		if (xfer->cb_done)
+			xfer->cb_done(xfer);
+		return;
+	}
+
+	/* Refill */
+	_usb_ep_fill(epr, eps, in);
+}
+
+void
+usb_ep_poll(void)
+{
+	for (int d=0; d<2; d++)
+		for (int i=0; i<15; i++)
+			if (g_usb.ep[d][i].xfer)
+				_usb_ep_poll_one(d ? &usb_ep_regs[i+1].in : &usb_ep_regs[i+1].out, &g_usb.ep[d][i], d);
+}
+
+static bool
+_usb_ep_queue(uint8_t ep, struct usb_xfer *xfer, bool zlp)
+{
+	volatile struct usb_ep *epr = _get_ep_regs(ep);
+	struct usb_ep_state *eps = _get_ep_state(ep);
+
+	/* Sanity checks. Any type, isoc included (usb_ep_is_configured()
+	 * only looks at the BCI bits). OUT needs room for a packet */
+	if (!eps || eps->xfer || !eps->mps)
+		return false;
+
+	if ((epr->status & 7) == USB_EP_TYPE_NONE)
+		return false;
+
+	if (!(ep & 0x80) && !xfer->len)
+		return false;
+
+	/* Setup state */
+	eps->xfer     = xfer;
+	eps->ofs_fill = eps->n_queued * eps->mps;	/* OUT packets kept by flush */
+	eps->n_bd     = (epr->status & USB_EP_BD_DUAL) ? 2 : 1;
+	eps->zlp      = (ep & 0x80) && (zlp || !xfer->len);
+
+	xfer->ofs = 0;
+
+	/* Submit as many BDs as possible */
+	_usb_ep_fill(epr, eps, ep & 0x80);
+
+	return true;
+}
+
+bool
+usb_ep_queue_in(uint8_t ep, struct usb_xfer *xfer, bool zlp)
+{
+	return _usb_ep_queue(ep | 0x80, xfer, zlp);
+}
+
+bool
+usb_ep_queue_out(uint8_t ep, struct usb_xfer *xfer)
+{
+	return _usb_ep_queue(ep & 0x7f, xfer, false);
+}
+
+bool
+usb_ep_busy(uint8_t ep)
+{
+	struct usb_ep_state *eps = _get_ep_state(ep);
+	return eps && (eps->xfer != NULL);
+}
+
+void
+usb_ep_cancel(uint8_t ep)
+{
+	struct usb_ep_state *eps = _get_ep_state(ep);
+
+	if (!eps || !eps->xfer)
+		return;
+
+	_usb_ep_flush(_get_ep_regs(ep), eps, ep & 0x80);
+	eps->xfer = NULL;
+}
+
+void
+usb_ep_reset(uint8_t ep)
+{
+	volatile struct usb_ep *epr = _get_ep_regs(ep);
+	struct usb_ep_state *eps = _get_ep_state(ep);
+
+	if (!eps)
+		return;
+
+	/* Cancel transfer and restart from BD0 / DATA0, as needed after a
+	 * SET_INTERFACE */
+	usb_ep_cancel(ep);
+	epr->bd[0].csr = 0;
+	epr->bd[1].csr = 0;
+	epr->status = epr->status & ~(USB_EP_DT_BIT | USB_EP_BD_IDX);
+	eps->n_queued = 0;
+	eps->bdi_fill = 0;
+	eps->bdi_done = 0;
+}
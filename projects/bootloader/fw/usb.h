@@ -90,11 +90,19 @@ struct usb_xfer {
 	int len;
 
 	/* Call backs */
-	usb_xfer_cb cb_data;	/* Data call back */
+	usb_xfer_cb cb_data;	/* Data call back, see below */
 	usb_xfer_cb cb_done;	/* Completion call back */
 	void *cb_ctx;
 };
 
+	/* On control transfers, setting cb_data allows a data stage longer
+	 * than the buffer (wLength > len). It's called whenever the buffer
+	 * is full (OUT) or empty (IN) and data is left, and must then set
+	 * data / len / ofs for the next chunk and return true. Returning
+	 * false NAKs the host and it will be called again from usb_poll().
+	 * For IN, a chunk with len = 0 ends the data stage early. The
+	 * chunk length must be a multiple of 64 */
+
 
 /* API */
 void usb_init(const struct usb_stack_descriptors *stack_desc);
@@ -120,6 +128,19 @@ bool usb_ep_is_halted(uint8_t ep);
 bool usb_ep_halt(uint8_t ep);
 bool usb_ep_resume(uint8_t ep);
 
+	/* Transfers on EP1-15, using the buffers set up on SET_CONFIGURATION.
+	 * `data` must be 4 bytes aligned, `ofs` holds the transferred length
+	 * when `cb_done` is called. OUT transfers end on a short packet or
+	 * when `len` is reached, which can't be 0. For IN, `zlp` appends a
+	 * ZLP if the length is a multiple of the max packet size, a 0 length
+	 * transfer sends one. Isochronous EPs work the same. Data toggles
+	 * are handled by the hardware, usb_ep_reset() restarts from DATA0 */
+bool usb_ep_queue_in(uint8_t ep, struct usb_xfer *xfer, bool zlp);
+bool usb_ep_queue_out(uint8_t ep, struct usb_xfer *xfer);
+bool usb_ep_busy(uint8_t ep);
+void usb_ep_cancel(uint8_t ep);
+void usb_ep_reset(uint8_t ep);
+
 	/* Descriptors */
 const void *usb_desc_find(const void *sod, const void *eod, uint8_t dt);
 const void *usb_desc_next(const void *sod);
@@ -0,0 +1,227 @@
+/*
+ * usb_bench.c
+ *
+ * USB throughput / latency benchmark function (vendor interface)
+ *
+ * Copyright (C) 2019 Sylvain Munaut
+ * All rights reserved.
+ *
+ * LGPL v3+, see LICENSE.lgpl3
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "usb.h"
+#include "usb_bench.h"
+
+
+static struct {
+	bool active;
+
+	struct usb_xfer sink;
+	struct usb_xfer source;
+	struct usb_xfer loop_out;
+	struct usb_xfer loop_in;
+
+	struct usb_bench_stats stats;
+
+	/* Buffers, must be 4 bytes aligned */
+	uint32_t buf_sink[USB_BENCH_XFER_LEN / 4];
+	uint32_t buf_source[USB_BENCH_XFER_LEN / 4];
+	uint32_t buf_loop[USB_BENCH_XFER_LEN / 4];
+} g_bench;
+
+
+/* Transfers */
+/* --------- */
+
+static bool
+_bench_sink_done(struct usb_xfer *xfer)
+{
+	g_bench.stats.sink_bytes += xfer->ofs;
+	g_bench.stats.sink_xfers++;
+	return usb_ep_queue_out(USB_BENCH_EP_SINK, xfer);
+}
+
+static bool
+_bench_source_done(struct usb_xfer *xfer)
+{
+	g_bench.stats.source_bytes += xfer->ofs;
+	g_bench.stats.source_xfers++;
+	return usb_ep_queue_in(USB_BENCH_EP_SOURCE, xfer, false);
+}
+
+static bool
+_bench_loop_out_done(struct usb_xfer *xfer)
+{
+	/* Send back exactly what we got. The host reads up to
+	 * USB_BENCH_XFER_LEN, so like on OUT, a ZLP is only needed on
+	 * multiples of the packet size below that */
+	int len = xfer->ofs;
+
+	g_bench.loop_in.len = len;
+	return usb_ep_queue_in(USB_BENCH_EP_LOOP_IN, &g_bench.loop_in,
+		!(len % USB_BENCH_MPS) && (len < USB_BENCH_XFER_LEN));
+}
+
+static bool
+_bench_loop_in_done(struct usb_xfer *xfer)
+{
+	g_bench.stats.loop_bytes += xfer->ofs;
+	g_bench.stats.loop_xfers++;
+	return usb_ep_queue_out(USB_BENCH_EP_LOOP_OUT, &g_bench.loop_out);
+}
+
+static void
+_bench_start(void)
+{
+	/* Reset the EPs (DATA0 / BD0) and restart all the transfers */
+	usb_ep_reset(USB_BENCH_EP_SINK);
+	usb_ep_reset(USB_BENCH_EP_SOURCE);
+	usb_ep_reset(USB_BENCH_EP_LOOP_OUT);
+	usb_ep_reset(USB_BENCH_EP_LOOP_IN);
+
+	g_bench.sink.len     = USB_BENCH_XFER_LEN;
+	g_bench.source.len   = USB_BENCH_XFER_LEN;
+	g_bench.loop_out.len = USB_BENCH_XFER_LEN;
+
+	g_bench.active =
+		usb_ep_queue_out(USB_BENCH_EP_SINK, &g_bench.sink) &&
+		usb_ep_queue_in(USB_BENCH_EP_SOURCE, &g_bench.source, false) &&
+		usb_ep_queue_out(USB_BENCH_EP_LOOP_OUT, &g_bench.loop_out);
+}
+
+
+/* Function driver */
+/* --------------- */
+
+static bool
+_bench_is_intf(const struct usb_intf_desc *intf)
+{
+	return intf &&
+		(intf->bInterfaceNumber == USB_BENCH_INTF) &&
+		(intf->bInterfaceClass == 0xff);
+}
+
+static void
+_bench_bus_reset(void)
+{
+	/* EP state is cleared by the core */
+	g_bench.active = false;
+}
+
+static enum usb_fnd_resp
+_bench_set_conf(const struct usb_conf_desc *conf)
+{
+	g_bench.active = false;
+
+	if (!conf || !_bench_is_intf(usb_desc_find_intf(conf, USB_BENCH_INTF, 0, NULL)))
+		return USB_FND_SUCCESS;
+
+	_bench_start();
+
+	return g_bench.active ? USB_FND_SUCCESS : USB_FND_ERROR;
+}
+
+static enum usb_fnd_resp
+_bench_set_intf(const struct usb_intf_desc *base, const struct usb_intf_desc *sel)
+{
+	if (!_bench_is_intf(base))
+		return USB_FND_CONTINUE;
+
+	if (sel->bAlternateSetting != 0)
+		return USB_FND_ERROR;
+
+	_bench_start();
+
+	return g_bench.active ? USB_FND_SUCCESS : USB_FND_ERROR;
+}
+
+static enum usb_fnd_resp
+_bench_get_intf(const struct usb_intf_desc *base, uint8_t *alt)
+{
+	if (!_bench_is_intf(base))
+		return USB_FND_CONTINUE;
+
+	*alt = 0;
+
+	return USB_FND_SUCCESS;
+}
+
+static enum usb_fnd_resp
+_bench_ctrl_req(struct usb_ctrl_req *req, struct usb_xfer *xfer)
+{
+	if (req->wIndex != USB_BENCH_INTF)
+		return USB_FND_CONTINUE;
+
+	switch (req->wRequestAndType)
+	{
+	case USB_RT_BENCH_GET_STATS:
+		g_bench.stats.tick = usb_get_tick();
+		memcpy(xfer->data, &g_bench.stats, sizeof(struct usb_bench_stats));
+		xfer->len = sizeof(struct usb_bench_stats);
+		break;
+
+	case USB_RT_BENCH_RESET:
+		memset(&g_bench.stats, 0x00, sizeof(struct usb_bench_stats));
+		break;
+
+	default:
+		return USB_FND_CONTINUE;
+	}
+
+	return USB_FND_SUCCESS;
+}
+
+static struct usb_fn_drv _bench_drv = {
+	.bus_reset	= _bench_bus_reset,
+	.ctrl_req	= _bench_ctrl_req,
+	.set_conf	= _bench_set_conf,
+	.set_intf	= _bench_set_intf,
+	.get_intf	= _bench_get_intf,
+};
+
+
+void
+usb_bench_init(void)
+{
+	uint8_t *p;
+	int i;
+
+	memset(&g_bench, 0x00, sizeof(g_bench));
+
+	/* Source data is a counter, allows the host to check for drops */
+	p = (uint8_t *)g_bench.buf_source;
+	for (i=0; i<USB_BENCH_XFER_LEN; i++)
+		p[i] = i;
+
+	g_bench.sink.data     = (uint8_t *)g_bench.buf_sink;
+	g_bench.sink.cb_done  = _bench_sink_done;
+
+	g_bench.source.data    = (uint8_t *)g_bench.buf_source;
+	g_bench.source.cb_done = _bench_source_done;
+
+	g_bench.loop_out.data    = (uint8_t *)g_bench.buf_loop;
+	g_bench.loop_out.cb_done = _bench_loop_out_done;
+
+	g_bench.loop_in.data    = (uint8_t *)g_bench.buf_loop;
+	g_bench.loop_in.cb_done = _bench_loop_in_done;
+
+	usb_register_function_driver(&_bench_drv);
+}
@@ -0,0 +1,52 @@
+/*
+ * usb_bench.h
+ *
+ * Copyright (C) 2019 Sylvain Munaut
+ * All rights reserved.
+ *
+ * LGPL v3+, see LICENSE.lgpl3
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+/* Protocol, shared with host/usb_bench.c */
+#define USB_BENCH_INTF		1
+
+#define USB_BENCH_EP_SINK	0x01	/* BULK OUT, data is discarded */
+#define USB_BENCH_EP_SOURCE	0x81	/* BULK IN, endless data stream */
+#define USB_BENCH_EP_LOOP_OUT	0x02	/* BULK OUT, sent back on EP2 IN */
+#define USB_BENCH_EP_LOOP_IN	0x82
+
+#define USB_BENCH_MPS		64
+#define USB_BENCH_XFER_LEN	1024	/* Max loopback transfer */
+
+#define USB_RT_BENCH_GET_STATS	((0x10 << 8) | 0xc1)
+#define USB_RT_BENCH_RESET	((0x11 << 8) | 0x41)
+
+struct usb_bench_stats {
+	uint32_t sink_bytes;
+	uint32_t sink_xfers;
+	uint32_t source_bytes;
+	uint32_t source_xfers;
+	uint32_t loop_bytes;
+	uint32_t loop_xfers;
+	uint32_t tick;		/* USB tick (ms) at the time of the request */
+} __attribute__((packed));
+
+void usb_bench_init(void);
@@ -29,8 +29,6 @@
 #include "usb_hw.h"
 #include "usb_priv.h"
 
-#define EP0_PKT_LEN	64
-
 /* Helpers to manipulate BDs */
 
 	/* IN */
@@ -110,10 +108,20 @@ usb_handle_control_data()
 {
 	/* Handle read requests */
 	if (g_usb.ctrl.state == DATA_IN) {
+		/* Buffer empty, let the handler refill it */
+		if ((g_usb.ctrl.xfer.ofs == g_usb.ctrl.xfer.len) && g_usb.ctrl.data_left &&
+		    g_usb.ctrl.xfer.cb_data && !g_usb.ctrl.xfer.cb_data(&g_usb.ctrl.xfer)) {
+			usb_ep0_in_clear();
+			g_usb.ctrl.data_wait = true;
+			return;
+		}
+
 		/* How much left to do ? */
 		int xflen = g_usb.ctrl.xfer.len - g_usb.ctrl.xfer.ofs;
 		if (xflen > EP0_PKT_LEN)
 			xflen = EP0_PKT_LEN;
+		if (xflen > g_usb.ctrl.data_left)
+			xflen = g_usb.ctrl.data_left;
 
 		/* Setup descriptor for output */
 		if (xflen)
@@ -122,6 +130,7 @@ usb_handle_control_data()
 
 		/* Move on */
 		g_usb.ctrl.xfer.ofs += xflen;
+		g_usb.ctrl.data_left -= xflen;
 
 		/* If we're done, setup the OUT ack */
 		if (xflen < EP0_PKT_LEN) {
@@ -143,13 +152,14 @@ usb_handle_control_data()
 
 			/* Move on */
 			g_usb.ctrl.xfer.ofs += xflen;
+			g_usb.ctrl.data_left -= xflen;
 
 			/* Done with that buffer */
 			usb_ep0_out_clear();
 		}
 
 		/* Next ? */
-		if (g_usb.ctrl.xfer.ofs == g_usb.ctrl.xfer.len)
+		if (g_usb.ctrl.data_left <= 0)
 		{
 			/* Done, ACK with a ZLP */
 			usb_ep0_in_queue_data(0);
@@ -157,6 +167,14 @@ usb_handle_control_data()
 		}
 		else if ((bds_out & USB_BD_STATE_MSK) != USB_BD_STATE_RDY_DATA)
 		{
+			/* Buffer full, let the handler consume it. Until it
+			 * does, no BD is submitted and the host gets NAKed */
+			if ((g_usb.ctrl.xfer.ofs == g_usb.ctrl.xfer.len) &&
+			    g_usb.ctrl.xfer.cb_data && !g_usb.ctrl.xfer.cb_data(&g_usb.ctrl.xfer)) {
+				g_usb.ctrl.data_wait = true;
+				return;
+			}
+
 			/* Submit next BD to fill */
 			usb_ep0_out_queue_data();
 		}
@@ -175,6 +193,7 @@ usb_handle_control_request(struct usb_ctrl_req *req)
 	g_usb.ctrl.xfer.cb_data = NULL;
 	g_usb.ctrl.xfer.cb_done = NULL;
 	g_usb.ctrl.xfer.cb_ctx  = NULL;
+	g_usb.ctrl.data_wait = false;
 
 	/* Dipatch to all handlers */
 	rv = usb_dispatch_ctrl_req(req, &g_usb.ctrl.xfer);
@@ -185,7 +204,7 @@ usb_handle_control_request(struct usb_ctrl_req *req)
 
 	/* Buffer size vs request size checks */
 	if (req->wLength > g_usb.ctrl.xfer.len) {
-		if (!USB_REQ_IS_READ(req)) {
+		if (!USB_REQ_IS_READ(req) && !g_usb.ctrl.xfer.cb_data) {
 			/* If this is a OUT treansaction and no suitable buffer was
 			 * provided, there isn't much we can do ... */
 			USB_LOG_ERR("[!] Control request handler failed to provide enough buffer space");
@@ -195,6 +214,10 @@ usb_handle_control_request(struct usb_ctrl_req *req)
 		g_usb.ctrl.xfer.len = req->wLength;
 	}
 
+	/* With a cb_data, the buffer is reused and the whole wLength is
+	 * transferred (unless the handler runs out of IN data) */
+	g_usb.ctrl.data_left = g_usb.ctrl.xfer.cb_data ? req->wLength : g_usb.ctrl.xfer.len;
+
 	/* Handle the 'data' stage now */
 	g_usb.ctrl.state = USB_REQ_IS_READ(req) ? DATA_IN : DATA_OUT;
 	usb_handle_control_data();
@@ -217,6 +240,7 @@ usb_ep0_reset(void)
 {
 	/* Reset internal state */
 	g_usb.ctrl.state = IDLE;
+	g_usb.ctrl.data_wait = false;
 
 	/* Configure EP0 */
 	usb_ep_regs[0].out.status = USB_EP_TYPE_CTRL | USB_EP_BD_CTRL; /* Type=Control, control mode buffered */
@@ -241,6 +265,12 @@ usb_ep0_poll(void)
 	uint32_t bds_setup, bds_out, bds_in;
 	bool acted;
 
+	/* Retry a data stage that was waiting on its handler */
+	if (g_usb.ctrl.data_wait) {
+		g_usb.ctrl.data_wait = false;
+		usb_handle_control_data();
+	}
+
 	do {
 		/* Not done anything yet */
 		acted = false;
@@ -218,9 +218,9 @@ _set_configuration(struct usb_ctrl_req *req, struct usb_xfer *xfer)
 	}
 
 	/* Update state */
-		/* FIXME: configure all endpoint */
 	g_usb.conf = conf;
 	g_usb.intf_alt = 0;
+	usb_ep_alloc(conf);
 	usb_set_state(new_state);
 	usb_dispatch_set_conf(g_usb.conf);
 
@@ -21,8 +21,16 @@
  * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
  */
 
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "misc.h"
 #include "usb_proto.h"
 #include "usb.h"
+#include "usb_dfu.h"
+#ifdef USB_BENCH
+#include "usb_bench.h"
+#endif
 
 #define NULL ((void*)0)
 #define num_elem(a) (sizeof(a) / sizeof(a[0]))
@@ -59,150 +67,7 @@ const uint8_t desc_ms_os_20[0x1E] = {
 };
 
 
-static const struct {
-	struct usb_conf_desc conf;
-	struct usb_intf_desc if_fpga;
-	struct usb_dfu_desc dfu_fpga;
-	struct usb_intf_desc if_riscv;
-	struct usb_dfu_desc dfu_riscv;
-	struct usb_intf_desc if_cart_fpga;
-	struct usb_dfu_desc dfu_cart_fpga;
-	struct usb_intf_desc if_cart_ipl;
-	struct usb_dfu_desc dfu_cart_ipl;
-	struct usb_intf_desc if_cart_tjftl;
-	struct usb_dfu_desc dfu_cart_tjftl;
-	struct usb_intf_desc if_bootloader;
-	struct usb_dfu_desc dfu_bootloader;
-} __attribute__ ((packed)) _dfu_conf_desc = {
-	.conf = {
-		.bLength                = sizeof(struct usb_conf_desc),
-		.bDescriptorType        = USB_DT_CONF,
-		.wTotalLength           = sizeof(_dfu_conf_desc),
-		.bNumInterfaces         = 1,
-		.bConfigurationValue    = 1,
-		.iConfiguration         = 4,
-		.bmAttributes           = 0x80,
-		.bMaxPower              = 0x32, /* 100 mA */
-	},
-	.if_fpga = {
-		.bLength		= sizeof(struct usb_intf_desc),
-		.bDescriptorType	= USB_DT_INTF,
-		.bInterfaceNumber	= 0,
-		.bAlternateSetting	= 0,
-		.bNumEndpoints		= 0,
-		.bInterfaceClass	= 0xfe,
-		.bInterfaceSubClass	= 0x01,
-		.bInterfaceProtocol	= 0x02,
-		.iInterface		= 5,
-	},
-	.dfu_fpga = {
-		.bLength		= sizeof(struct usb_dfu_desc),
-		.bDescriptorType	= USB_DT_DFU,
-		.bmAttributes		= 0x0d,
-		.wDetachTimeOut		= 1000,
-		.wTransferSize		= 4096,
-		.bcdDFUVersion		= 0x0101,
-	},
-	.if_riscv = {
-		.bLength		= sizeof(struct usb_intf_desc),
-		.bDescriptorType	= USB_DT_INTF,
-		.bInterfaceNumber	= 0,
-		.bAlternateSetting	= 1,
-		.bNumEndpoints		= 0,
-		.bInterfaceClass	= 0xfe,
-		.bInterfaceSubClass	= 0x01,
-		.bInterfaceProtocol	= 0x02,
-		.iInterface		= 6,
-	},
-	.dfu_riscv = {
-		.bLength		= sizeof(struct usb_dfu_desc),
-		.bDescriptorType	= USB_DT_DFU,
-		.bmAttributes		= 0x0d,
-		.wDetachTimeOut		= 1000,
-		.wTransferSize		= 4096,
-		.bcdDFUVersion		= 0x0101,
-	},
-	.if_cart_fpga = {
-		.bLength		= sizeof(struct usb_intf_desc),
-		.bDescriptorType	= USB_DT_INTF,
-		.bInterfaceNumber	= 0,
-		.bAlternateSetting	= 2,
-		.bNumEndpoints		= 0,
-		.bInterfaceClass	= 0xfe,
-		.bInterfaceSubClass	= 0x01,
-		.bInterfaceProtocol	= 0x02,
-		.iInterface		= 7,
-	},
-	.dfu_cart_fpga = {
-		.bLength		= sizeof(struct usb_dfu_desc),
-		.bDescriptorType	= USB_DT_DFU,
-		.bmAttributes		= 0x0d,
-		.wDetachTimeOut		= 1000,
-		.wTransferSize		= 4096,
-		.bcdDFUVersion		= 0x0101,
-	},
-	.if_cart_ipl = {
-		.bLength		= sizeof(struct usb_intf_desc),
-		.bDescriptorType	= USB_DT_INTF,
-		.bInterfaceNumber	= 0,
-		.bAlternateSetting	= 3,
-		.bNumEndpoints		= 0,
-		.bInterfaceClass	= 0xfe,
-		.bInterfaceSubClass	= 0x01,
-		.bInterfaceProtocol	= 0x02,
-		.iInterface		= 8,
-	},
-	.dfu_cart_ipl = {
-		.bLength		= sizeof(struct usb_dfu_desc),
-		.bDescriptorType	= USB_DT_DFU,
-		.bmAttributes		= 0x0d,
-		.wDetachTimeOut		= 1000,
-		.wTransferSize		= 4096,
-		.bcdDFUVersion		= 0x0101,
-	},
-	.if_cart_tjftl = {
-		.bLength		= sizeof(struct usb_intf_desc),
-		.bDescriptorType	= USB_DT_INTF,
-		.bInterfaceNumber	= 0,
-		.bAlternateSetting	= 4,
-		.bNumEndpoints		= 0,
-		.bInterfaceClass	= 0xfe,
-		.bInterfaceSubClass	= 0x01,
-		.bInterfaceProtocol	= 0x02,
-		.iInterface		= 9,
-	},
-	.dfu_cart_tjftl = {
-		.bLength		= sizeof(struct usb_dfu_desc),
-		.bDescriptorType	= USB_DT_DFU,
-		.bmAttributes		= 0x0d,
-		.wDetachTimeOut		= 1000,
-		.wTransferSize		= 4096,
-		.bcdDFUVersion		= 0x0101,
-	},
-	.if_bootloader = {
-		.bLength		= sizeof(struct usb_intf_desc),
-		.bDescriptorType	= USB_DT_INTF,
-		.bInterfaceNumber	= 0,
-		.bAlternateSetting	= 5,
-		.bNumEndpoints		= 0,
-		.bInterfaceClass	= 0xfe,
-		.bInterfaceSubClass	= 0x01,
-		.bInterfaceProtocol	= 0x02,
-		.iInterface		= 10,
-	},
-	.dfu_bootloader = {
-		.bLength		= sizeof(struct usb_dfu_desc),
-		.bDescriptorType	= USB_DT_DFU,
-		.bmAttributes		= 0x0d,
-		.wDetachTimeOut		= 1000,
-		.wTransferSize		= 4096,
-		.bcdDFUVersion		= 0x0101,
-	},
-};
-
-static const struct usb_conf_desc * const _conf_desc_array[] = {
-	&_dfu_conf_desc.conf,
-};
+#include "usb_desc_dfu.gen.h"
 
 static const struct usb_dev_desc _dev_desc = {
 	.bLength		= sizeof(struct usb_dev_desc),
@@ -218,7 +83,7 @@ static const struct usb_dev_desc _dev_desc = {
 	.iManufacturer		= 2,
 	.iProduct		= 3,
 	.iSerialNumber		= 1,
-	.bNumConfigurations	= num_elem(_conf_desc_array),
+	.bNumConfigurations	= 1,
 };
 
 static const struct {
@@ -251,8 +116,6 @@ static const struct {
 };
 
 
-#include "usb_str_dfu.gen.h"
-
 const struct usb_stack_descriptors dfu_stack_desc = {
 	.dev    = &_dev_desc,
 	.bos    = &_dfu_bos_desc.bos,
@@ -261,3 +124,23 @@ const struct usb_stack_descriptors dfu_stack_desc = {
 	.str    = _str_desc_array,
 	.n_str  = num_elem(_str_desc_array),
 };
+
+const struct usb_stack_descriptors dfu_stack_desc_wp = {
+	.dev    = &_dev_desc,
+	.bos    = &_dfu_bos_desc.bos,
+	.conf   = _conf_desc_wp_array,
+	.n_conf = num_elem(_conf_desc_wp_array),
+	.str    = _str_desc_array,
+	.n_str  = num_elem(_str_desc_array),
+};
+
+
+void
+usb_dfu_set_serial(const char *id)
+{
+	/* The serial string is the only descriptor not in rodata */
+	int l = (_str1_desc.bLength - 2) >> 1;
+
+	for (int i=0; i<l && id[i]; i++)
+		_str1_desc.wString[i] = id[i];
+}
@@ -29,6 +29,7 @@
 #include "usb.h"
 #include "usb_dfu.h"
 #include "usb_dfu_proto.h"
+#include "usb_dfu_vendor.h"
 #include "misc.h"
 
 
@@ -37,13 +38,29 @@
 #undef DFU_SOF_POLL_LIMIT
 #define DFU_HOST_POLL_MS		5
 
+/* LCD progress bar refresh period (ms), each refresh only costs a
+ * dozen register writes, the drawing itself is done by the blitter */
+#define DFU_PROGRESS_MS			100
+
+/* Image size at which the bar is half full (see _dfu_progress()) */
+#define DFU_PROGRESS_HALF		(512 * 1024)
+
 /* erase size: 4/32/64 KB (CPU RAM allows only 4KB) */
 #define ERASE_SIZE_KB 4
 
+/* DNLOAD buffers hold one flash sector, plus room for the end of a
+ * packet crossing it when blocks aren't a multiple of the sector size
+ * (slack is the EP0 packet size) */
+#define DFU_BUF_SIZE	4096
+#define DFU_BUF_SLACK	64
+
 /* max retry number of erase or write attempts at the same sector */
 #define PROG_RETRY 4
 static unsigned prog_retry = PROG_RETRY;
 
+/* Linker provided, holds the DFU buffers */
+extern uint8_t _sscratch[];
+
 #if 0
 #include "console.h"
 #define DBG_PRINTF(...) printf(__VA_ARGS__)
@@ -135,7 +152,11 @@ static struct {
 		uint8_t wr;
 		uint8_t rd;
 
-		uint8_t data[2][4096] __attribute__((aligned(4)));
+		uint8_t (*data)[DFU_BUF_SIZE + DFU_BUF_SLACK];	/* 2 buffers, in the scratch area */
+
+		int fill;	/* DNLOAD bytes in the write buffer */
+		int spill;	/* and past its end, to move to the next one */
+		int xfer_left;	/* DNLOAD/UPLOAD bytes not yet in a buffer */
 	} buf;
 
 	struct {
@@ -157,19 +178,32 @@ static struct {
 	} flash;
 } g_dfu;
 
-static const struct {
-	uint32_t flashsel;
-	uint32_t start;
-	uint32_t end;
-} dfu_zones[7] = {
-	{ FLASHCHIP_INTERNAL, 0x00200000, 0x01000000 },	/* 0 user bitstream and data */
-	{ FLASHCHIP_INTERNAL, 0x00340000, 0x00360000 },	/* 1 saxonsoc fw_jump  */
-	{ FLASHCHIP_INTERNAL, 0x00360000, 0x00400000 },	/* 2 saxonsoc u-boot */
-	{ FLASHCHIP_INTERNAL, 0x00400000, 0x01000000 },	/* 3 user data */
-	{ FLASHCHIP_INTERNAL, 0x00800000, 0x01000000 },	/* 4 user data */
-	{ FLASHCHIP_INTERNAL, 0x00000000, 0x00200000 },	/* 5 bootloader bitstream */
-	{ FLASHCHIP_CART,     0x00000000, 0x00000100 },	/* 6 RTC */
-};
+#ifdef HAS_LCD
+static void
+_dfu_progress(bool done)
+{
+	static uint32_t last = 0;
+	uint32_t now = usb_get_tick();
+	uint32_t n = g_dfu.flash.addr_prog - dfu_zones[g_dfu.alt].start;
+
+	/* Everything is in flash, fill the bar */
+	if (done) {
+		while (!lcd_progress_update(1, 1));
+		return;
+	}
+
+	/* Rate limit */
+	if ((now - last) < DFU_PROGRESS_MS)
+		return;
+
+	/* DFU doesn't give the image size up front, and the zones are much
+	 * larger than most images. So the bar tends to full as n / (n + half)
+	 * instead : always moving, and only full at manifest.
+	 * Retried on next tick if the LCD is still busy */
+	if (lcd_progress_update(n, n + DFU_PROGRESS_HALF))
+		last = now;
+}
+#endif
 
 /* DBG print descriptive text */
 char *should_txt[4] = {"do nothing", "erase", "write", "erase and write"};
@@ -179,6 +213,7 @@ void
 _dfu_tick(void)
 {
 	static uint8_t should = 0; // erase and/or write
+	static bool erased = false; // current sector erased, all its pages need writing
 
 	/* Rate limit to once every 10 ms */
 #ifdef DFU_SOF_POLL_LIMIT
@@ -187,6 +222,10 @@ _dfu_tick(void)
 	g_dfu.tick = 0;
 #endif
 
+#ifdef HAS_LCD
+	_dfu_progress(false);
+#endif
+
 	/* Anything to do ? Is flash ready ? */
 	if (g_dfu.flash.op == FL_IDLE) {
 		if (g_dfu.buf.used) {
@@ -209,6 +248,7 @@ _dfu_tick(void)
 	{
 		DBG_PRINTF("Verify error @ %08x - t=%d\n", g_dfu.flash.addr_prog, usb_get_tick());
 		g_dfu.flash.op = FL_IDLE;
+		erased = false;
 		g_dfu.buf.rd ^= 1;
 		g_dfu.buf.used--;
 		usb_dfu_cb_reboot(); /* TODO: find better way to stop current upload */
@@ -230,6 +270,7 @@ _dfu_tick(void)
 			/* erase */
 			if(prog_retry)
 				prog_retry--;
+			erased = true;
 			g_dfu.flash.addr_erase = g_dfu.flash.addr_prog;
 			DBG_PRINTF("Erase start %d retries left %dk @ %08x - t=%d\n", 
 				prog_retry, ERASE_SIZE_KB, g_dfu.flash.addr_erase, usb_get_tick());
@@ -260,6 +301,7 @@ _dfu_tick(void)
 			g_dfu.buf.rd ^= 1;
 			g_dfu.buf.used--;
 			g_dfu.flash.op = FL_IDLE;
+			erased = false;
 		}
 		else if (g_dfu.flash.op_ofs == g_dfu.flash.op_len) { /* program done? */
 			/* Yes ! */
@@ -279,10 +321,14 @@ _dfu_tick(void)
 			if (l > pl)
 				l = pl;
 
-			/* Write page */
-			DBG_PRINTF("Page program start @ %08x - t=%d\n", g_dfu.flash.addr_prog + g_dfu.flash.op_ofs, usb_get_tick());
-			flash_write_enable();
-			flash_page_program(&g_dfu.buf.data[g_dfu.buf.rd][g_dfu.flash.op_ofs], g_dfu.flash.addr_prog + g_dfu.flash.op_ofs, l);
+			/* Write page. If the sector only needed writing (should
+			 * was 2, no erase), skip the pages that are already right
+			 * so small updates only program what changed */
+			if (erased || flash_verify(&g_dfu.buf.data[g_dfu.buf.rd][g_dfu.flash.op_ofs], g_dfu.flash.addr_prog + g_dfu.flash.op_ofs, l)) {
+				DBG_PRINTF("Page program start @ %08x - t=%d\n", g_dfu.flash.addr_prog + g_dfu.flash.op_ofs, usb_get_tick());
+				flash_write_enable();
+				flash_page_program(&g_dfu.buf.data[g_dfu.buf.rd][g_dfu.flash.op_ofs], g_dfu.flash.addr_prog + g_dfu.flash.op_ofs, l);
+			}
 
 			/* Next page */
 			g_dfu.flash.op_ofs += l;
@@ -311,12 +357,127 @@ _dfu_detach_done_cb(struct usb_xfer *xfer)
 	return true;
 }
 
+/* Hands the write buffer over to flash once it holds a full sector and
+ * moves what spilled past its end to the next one as soon as that's
+ * free. Returns true when the write buffer can take more data */
+static bool
+_dfu_buf_commit(void)
+{
+	if (g_dfu.buf.fill >= DFU_BUF_SIZE) {
+		g_dfu.buf.spill = g_dfu.buf.fill - DFU_BUF_SIZE;
+		g_dfu.buf.fill  = 0;
+		g_dfu.buf.wr ^= 1;
+		g_dfu.buf.used++;
+	}
+
+	if (g_dfu.buf.used == 2)
+		return false;
+
+	if (g_dfu.buf.spill) {
+		memcpy(g_dfu.buf.data[g_dfu.buf.wr], &g_dfu.buf.data[g_dfu.buf.wr ^ 1][DFU_BUF_SIZE], g_dfu.buf.spill);
+		g_dfu.buf.fill  = g_dfu.buf.spill;
+		g_dfu.buf.spill = 0;
+	}
+
+	return true;
+}
+
+/* Pads and hands over the last, partial, sector. Returns true once
+ * everything received is with the flash */
+static bool
+_dfu_buf_flush(void)
+{
+	if (!_dfu_buf_commit())
+		return false;
+
+	if (g_dfu.buf.fill) {
+		if (dfu_zones[g_dfu.alt].flags & DFU_ZONE_KEEP) {
+			/* Pad with what's in flash after the image, so it's
+			 * kept and, if the update only clears bits, the
+			 * sector isn't even erased. Flash must be idle. */
+			if (g_dfu.buf.used)
+				return false;
+
+			flashchip_select(g_dfu.flash.selected);
+			while (flash_read_sr() & 1);
+
+			flash_read(&g_dfu.buf.data[g_dfu.buf.wr][g_dfu.buf.fill], g_dfu.flash.addr_recv, DFU_BUF_SIZE - g_dfu.buf.fill);
+		} else {
+			memset(&g_dfu.buf.data[g_dfu.buf.wr][g_dfu.buf.fill], 0xff, DFU_BUF_SIZE - g_dfu.buf.fill);
+		}
+
+		g_dfu.buf.fill = DFU_BUF_SIZE;
+		_dfu_buf_commit();
+	}
+
+	return true;
+}
+
+static void
+_dfu_dnload_next(struct usb_xfer *xfer)
+{
+	/* Blocks of any size are appended in the write buffer, sectors only
+	 * go to flash when full, or at manifest */
+	int len = g_dfu.buf.xfer_left;
+
+	/* Up to the end of the sector, in whole packets (the data stage is
+	 * split in packets from the start of the block, and we're always
+	 * called on a packet boundary) */
+	if (len > DFU_BUF_SIZE - g_dfu.buf.fill) {
+		len = (DFU_BUF_SIZE - g_dfu.buf.fill + DFU_BUF_SLACK - 1) & ~(DFU_BUF_SLACK - 1);
+		if (len > g_dfu.buf.xfer_left)
+			len = g_dfu.buf.xfer_left;
+	}
+
+	xfer->data = &g_dfu.buf.data[g_dfu.buf.wr][g_dfu.buf.fill];
+	xfer->len  = len;
+	xfer->ofs  = 0;
+
+	g_dfu.buf.fill      += len;
+	g_dfu.buf.xfer_left -= len;
+}
+
+static bool
+_dfu_dnload_data_cb(struct usb_xfer *xfer)
+{
+	/* Hand the buffer over to flash if full, and wait for the next one
+	 * to be free, _dfu_tick() still runs */
+	if (!_dfu_buf_commit())
+		return false;
+
+	_dfu_dnload_next(xfer);
+
+	return true;
+}
+
+static bool
+_dfu_upload_data_cb(struct usb_xfer *xfer)
+{
+	/* Flash is read synchronously, using both buffers */
+	int len = g_dfu.buf.xfer_left;
+
+	if (len > 2 * 4096)
+		len = 2 * 4096;
+
+	xfer->data = g_dfu.buf.data[0];
+	xfer->len  = len;
+	xfer->ofs  = 0;
+
+	if (len) {
+		flash_read(xfer->data, g_dfu.flash.addr_read, len);
+		g_dfu.flash.addr_read += len;
+		g_dfu.buf.xfer_left -= len;
+	}
+
+	return true;
+}
+
 static bool
 _dfu_dnload_done_cb(struct usb_xfer *xfer)
 {
-	/* Next buffer */
-	g_dfu.buf.wr ^= 1;
-	g_dfu.buf.used++;
+	/* Hand over the buffer if the block filled it, if the next one
+	 * isn't free yet, GETSTATUS answers dfuDNBUSY until it is */
+	_dfu_buf_commit();
 
 	/* State update */
 	g_dfu.state = dfuDNLOAD_SYNC;
@@ -337,7 +498,7 @@ _dfu_ctrl_req(struct usb_ctrl_req *req, struct usb_xfer *xfer)
 	if ((USB_REQ_TYPE(req) | USB_REQ_RCPT(req)) == (USB_REQ_TYPE_VENDOR | USB_REQ_RCPT_INTF)) {
 		/* Let vendor code use our large buffer */
 		xfer->data = g_dfu.buf.data[0];
-		xfer->len  = sizeof(g_dfu.buf);
+		xfer->len  = DFU_VENDOR_BUF_SIZE;
 
 		/* Call vendor code */
 		return dfu_vendor_ctrl_req(req, xfer);
@@ -366,18 +527,20 @@ _dfu_ctrl_req(struct usb_ctrl_req *req, struct usb_xfer *xfer)
 			/* Check length doesn't overflow */
 			g_dfu.flash.addr_recv += req->wLength;
 
-			if (g_dfu.flash.addr_recv > g_dfu.flash.addr_end)
+			if ((g_dfu.flash.addr_recv > g_dfu.flash.addr_end) ||
+			    (req->wLength > dfu_zones[g_dfu.alt].xfer_size))
 				goto error;
 
-			/* Setup buffer for data */
-			xfer->len     = req->wLength;
-			xfer->data    = g_dfu.buf.data[g_dfu.buf.wr];
-			xfer->cb_done = _dfu_dnload_done_cb;
+			/* No buffer yet, the data callback appends the block
+			 * to the current sector (once it's free), blocks larger
+			 * than what's left are streamed through both buffers
+			 * while the flash is being programmed */
+			g_dfu.buf.xfer_left = req->wLength;
 
-			/* Fill end of buffer with 0xff if not fully used */
-			if (xfer->len < 4096) {
-				memset(&xfer->data[xfer->len], 0xff, 4096 - xfer->len);
-			}
+			xfer->len = 0;
+
+			xfer->cb_data = _dfu_dnload_data_cb;
+			xfer->cb_done = _dfu_dnload_done_cb;
 		} else {
 			/* Last xfer */
 			g_dfu.state = dfuMANIFEST_SYNC;
@@ -389,25 +552,21 @@ _dfu_ctrl_req(struct usb_ctrl_req *req, struct usb_xfer *xfer)
 		 * flash synchronously here, not a big deal since we have
 		 * nothing better to do anyway */
 
-		/* Setup buffer for data */
-		xfer->len  = req->wLength;
-		xfer->data = g_dfu.buf.data[0];
-
 		/* Check length doesn't overflow */
-		if ((g_dfu.flash.addr_read + xfer->len) > g_dfu.flash.addr_end)
-			xfer->len = g_dfu.flash.addr_end - g_dfu.flash.addr_read;
+		g_dfu.buf.xfer_left = req->wLength;
 
-		/* Read */
-		if (xfer->len) {
-			flash_read(xfer->data, g_dfu.flash.addr_read, xfer->len);
-			g_dfu.flash.addr_read += xfer->len;
-		}
+		if ((g_dfu.flash.addr_read + g_dfu.buf.xfer_left) > g_dfu.flash.addr_end)
+			g_dfu.buf.xfer_left = g_dfu.flash.addr_end - g_dfu.flash.addr_read;
+
+		/* Read the first chunk, more is read as it gets sent */
+		_dfu_upload_data_cb(xfer);
+		xfer->cb_data = _dfu_upload_data_cb;
 		break;
 
 	case USB_RT_DFU_GETSTATUS:
 		/* Update state */
 		if (g_dfu.state == dfuDNLOAD_SYNC) {
-			if (g_dfu.buf.used < 2) {
+			if (_dfu_buf_commit()) {
 				g_dfu.state = state = dfuDNLOAD_IDLE;
 			} else {
 				state = dfuDNBUSY;
@@ -419,11 +578,19 @@ _dfu_ctrl_req(struct usb_ctrl_req *req, struct usb_xfer *xfer)
 			 * poll timeout ... */
 			g_dfu.state = state = dfuIDLE;
 
+			while (!_dfu_buf_flush())
+				_dfu_tick();
 			while (g_dfu.buf.used)
 				_dfu_tick();
+#ifdef HAS_LCD
+			_dfu_progress(true);
+#endif
 #else
-			if (g_dfu.buf.used == 0) {
+			if (_dfu_buf_flush() && (g_dfu.buf.used == 0)) {
 				g_dfu.state = state = dfuIDLE;
+#ifdef HAS_LCD
+				_dfu_progress(true);
+#endif
 			} else {
 				state = dfuMANIFEST;
 			}
@@ -488,6 +655,9 @@ _dfu_set_intf(const struct usb_intf_desc *base, const struct usb_intf_desc *sel)
 	g_dfu.flash.addr_end   = dfu_zones[g_dfu.alt].end;
 	g_dfu.flash.selected   = dfu_zones[g_dfu.alt].flashsel;
 
+	g_dfu.buf.fill  = 0;
+	g_dfu.buf.spill = 0;
+
 	return USB_FND_SUCCESS;
 }
 
@@ -526,6 +696,9 @@ usb_dfu_init(void)
 {
 	memset(&g_dfu, 0x00, sizeof(g_dfu));
 
+	/* The scratch area may hold boot data until now, see lnk-app.lds */
+	g_dfu.buf.data = (void *)_sscratch;
+
 	g_dfu.state = appDETACH;
 
 	usb_register_function_driver(&_dfu_drv);
@@ -23,6 +23,25 @@
 
 #pragma once
 
+#include <stdint.h>
+
+/* Flash zone of each alt setting, generated from dfu_zones.txt */
+struct dfu_zone {
+	uint32_t flashsel;
+	uint32_t start;
+	uint32_t end;
+	uint32_t xfer_size;
+	uint32_t flags;
+};
+
+/* The end of the last sector written is kept, not erased */
+#define DFU_ZONE_KEEP	(1 << 0)
+
+extern const struct dfu_zone dfu_zones[];
+extern const int dfu_n_zones;
+
+void usb_dfu_set_serial(const char *id);
+
 void usb_dfu_cb_reboot(void);
 void usb_dfu_init(void);
 void _dfu_tick(void);
\ No newline at end of file
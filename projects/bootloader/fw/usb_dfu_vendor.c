@@ -25,13 +25,11 @@
 #include <stdbool.h>
 #include <string.h>
 
-#include "usb.h"
+#include "misc.h"
 #include "spi.h"
-
-
-#define USB_RT_DFU_VENDOR_VERSION	((0 << 8) | 0xc1)
-#define USB_RT_DFU_VENDOR_SPI_EXEC	((1 << 8) | 0x41)
-#define USB_RT_DFU_VENDOR_SPI_RESULT	((2 << 8) | 0xc1)
+#include "spi_prog.h"
+#include "usb.h"
+#include "usb_dfu_vendor.h"
 
 
 static bool
@@ -44,6 +42,29 @@ _dfu_vendor_spi_exec_cb(struct usb_xfer *xfer)
 	return true;
 }
 
+static void
+_dfu_vendor_spi_prog_xfer(unsigned cs, uint8_t *hdr, unsigned hdr_len, uint8_t *data, unsigned len)
+{
+	struct spi_xfer_chunk sx[2] = {
+		{ .data = hdr,  .len = hdr_len, .read = true, .write = true, },
+		{ .data = data, .len = len,     .read = true, .write = true, },
+	};
+	spi_xfer(cs, sx, 2);
+}
+
+static const struct spi_prog_ops _dfu_vendor_spi_prog_ops = {
+	.xfer      = _dfu_vendor_spi_prog_xfer,
+	.flash_sel = flashchip_select,
+};
+
+static bool
+_dfu_vendor_spi_prog_cb(struct usb_xfer *xfer)
+{
+	/* Runs to completion, the host waits on SPI_RESULT */
+	spi_prog_run(&_dfu_vendor_spi_prog_ops, xfer->data, xfer->len);
+	return true;
+}
+
 enum usb_fnd_resp
 dfu_vendor_ctrl_req(struct usb_ctrl_req *req, struct usb_xfer *xfer)
 {
@@ -51,14 +72,18 @@ dfu_vendor_ctrl_req(struct usb_ctrl_req *req, struct usb_xfer *xfer)
 	{
 	case USB_RT_DFU_VENDOR_VERSION:
 		xfer->len  = 2;
-		xfer->data[0] = 0x01;
-		xfer->data[1] = 0x00;
+		xfer->data[0] = DFU_VENDOR_VERSION & 0xff;
+		xfer->data[1] = DFU_VENDOR_VERSION >> 8;
 		break;
 
 	case USB_RT_DFU_VENDOR_SPI_EXEC:
 		xfer->cb_done = _dfu_vendor_spi_exec_cb;
 		break;
 
+	case USB_RT_DFU_VENDOR_SPI_PROG:
+		xfer->cb_done = _dfu_vendor_spi_prog_cb;
+		break;
+
 	case USB_RT_DFU_VENDOR_SPI_RESULT:
 		/* Really nothing to do, data is already in the buffer, and we serve
 		 * whatever the host requested ... */
@@ -0,0 +1,78 @@
+/*
+ * usb_dfu_vendor.h
+ *
+ * Vendor requests on the DFU interface, shared with the host tools
+ *
+ * Copyright (C) 2019 Sylvain Munaut
+ * All rights reserved.
+ *
+ * LGPL v3+, see LICENSE.lgpl3
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#pragma once
+
+/* wRequestAndType values, wIndex is the DFU interface */
+#define USB_RT_DFU_VENDOR_VERSION	((0 << 8) | 0xc1)
+#define USB_RT_DFU_VENDOR_SPI_EXEC	((1 << 8) | 0x41)
+#define USB_RT_DFU_VENDOR_SPI_RESULT	((2 << 8) | 0xc1)
+#define USB_RT_DFU_VENDOR_SPI_PROG	((3 << 8) | 0x41)
+
+/* VERSION answer (LE16), SPI_PROG exists from 2 */
+#define DFU_VENDOR_VERSION		2
+
+/*
+ * SPI_EXEC : the OUT data is sent to the active flash as a single CS
+ * framed full duplex transfer, and the received bytes replace it in the
+ * buffer. SPI_RESULT reads them back. Up to DFU_VENDOR_BUF_SIZE bytes.
+ */
+#define DFU_VENDOR_BUF_SIZE		8192
+
+/*
+ * SPI_PROG : the OUT data is a program run on the device, the buffer
+ * (read back with SPI_RESULT) then holds the status and what was read.
+ *
+ *   [0]    status (DFU_SPI_ST_*), written by the device
+ *   [1]    reserved
+ *   [2:3]  offset of the failed opcode (LE), written by the device
+ *   [4:]   opcodes and their arguments (LE), up to DFU_SPI_OP_END
+ *
+ * Transfers are CS framed and full duplex, received bytes replace the
+ * sent ones. XFER_A sends its command and the 24 bits address register,
+ * then len bytes at the data pointer (an offset in the buffer) that is
+ * then advanced, so a LOOP can walk through an address range and the
+ * matching data.
+ */
+#define DFU_SPI_OP_END		0x00	/* */
+#define DFU_SPI_OP_CS		0x01	/* cs        : SPI_CS_* of the next transfers */
+#define DFU_SPI_OP_FLASH	0x02	/* sel       : flashchip_select() */
+#define DFU_SPI_OP_XFER		0x03	/* len16 data[len] */
+#define DFU_SPI_OP_XFER_A	0x04	/* cmd len16 */
+#define DFU_SPI_OP_WAIT		0x05	/* cmd mask  : poll until (reg & mask) == 0 */
+#define DFU_SPI_OP_ADDR		0x06	/* addr32 */
+#define DFU_SPI_OP_ADDR_ADD	0x07	/* inc32 */
+#define DFU_SPI_OP_DATA		0x08	/* ofs16     : data pointer */
+#define DFU_SPI_OP_LOOP		0x09	/* count16   : up to the matching ENDLOOP */
+#define DFU_SPI_OP_ENDLOOP	0x0a	/* */
+
+#define DFU_SPI_ST_OK		0x00
+#define DFU_SPI_ST_BAD_OP	0x01	/* Unknown opcode or bad CS / flash */
+#define DFU_SPI_ST_BOUNDS	0x02	/* Argument or data outside of the buffer */
+#define DFU_SPI_ST_TIMEOUT	0x03	/* WAIT took too long */
+#define DFU_SPI_ST_LOOP		0x04	/* Loops nested too deep or unbalanced */
+
+#define DFU_SPI_PROG_HDR	4
+#define DFU_SPI_LOOP_DEPTH	4
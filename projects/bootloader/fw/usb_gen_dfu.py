@@ -0,0 +1,274 @@
+#!/usr/bin/env python3
+
+#
+# Generates the DFU configuration descriptors, the string descriptors
+# and the dfu_zones[] table from the zone list, so that the partition
+# layout is only described in one place.
+#
+# Usage: usb_gen_dfu.py usb_str_dfu.txt dfu_zones.txt output.gen.h [board]
+#
+# usb_str_dfu.txt holds the fixed strings (index 1 = serial number, kept
+# writable, see usb_dfu_set_serial()), one per line. A line starting with
+# '!' is a JSON dict of per-board values, '' being the default.
+#
+# dfu_zones.txt holds one zone per line, in alt setting order :
+#
+#   flash  start  end  transfer_size  flags  name
+#
+#  - flash is 'internal' or 'cart'
+#  - end is exclusive
+#  - flags is a comma separated list or '-'
+#      protect : not exposed when the bootloader is write protected
+#      hidden  : only in dfu_zones[], no descriptor
+#      keep    : the end of the last sector written keeps its content,
+#                for small updates at the start of a zone
+#  - the interface string is "<start>-<end-1> <name>"
+#
+
+import json
+import sys
+
+
+FLASH_SEL = {
+	'internal': 'FLASHCHIP_INTERNAL',
+	'cart':     'FLASHCHIP_CART',
+}
+
+DFU_XFER_MAX = 32768	# Larger than the buffers is streamed, see usb_dfu.c
+
+
+class Zone:
+
+	def __init__(self, line, lineno):
+		f = line.split(None, 5)
+		if len(f) != 6:
+			raise ValueError('Line %d: Invalid zone' % lineno)
+
+		if f[0] not in FLASH_SEL:
+			raise ValueError('Line %d: Unknown flash "%s"' % (lineno, f[0]))
+
+		self.flash = f[0]
+		self.start = int(f[1], 0)
+		self.end   = int(f[2], 0)
+		self.xfer  = int(f[3], 0)
+		self.flags = set() if f[4] == '-' else set(f[4].split(','))
+		self.name  = f[5].strip()
+
+		if self.end <= self.start:
+			raise ValueError('Line %d: Empty zone' % lineno)
+
+		# Each DNLOAD block must cover whole flash sectors
+		if (self.xfer < 4096) or (self.xfer > DFU_XFER_MAX) or (self.xfer & 4095):
+			raise ValueError('Line %d: Invalid transfer size' % lineno)
+
+		if self.flags - set(['protect', 'hidden', 'keep']):
+			raise ValueError('Line %d: Unknown flags' % lineno)
+
+	@property
+	def label(self):
+		return '0x%06X-0x%06X %s' % (self.start, self.end - 1, self.name)
+
+
+def load_strings(fn, board):
+	rv = []
+	with open(fn, 'r') as fh:
+		for ld in fh.readlines():
+			ld = ld.strip()
+			if ld.startswith('!{'):
+				ld = json.loads(ld[1:])
+				ld = ld[board] if board in ld else ld['']
+			rv.append(ld)
+	return rv
+
+
+def load_zones(fn):
+	rv = []
+	with open(fn, 'r') as fh:
+		for i, l in enumerate(fh.readlines()):
+			l = l.strip()
+			if not l or l.startswith('#'):
+				continue
+			rv.append(Zone(l, i+1))
+
+	# Alt setting number is the index in dfu_zones[], so the zones with
+	# a descriptor must come first, and the protected ones last of those
+	vis = [not ('hidden' in z.flags) for z in rv]
+	if vis != sorted(vis, reverse=True):
+		raise ValueError('Hidden zones must be last')
+
+	pro = [('protect' in z.flags) for z in rv if not ('hidden' in z.flags)]
+	if pro != sorted(pro):
+		raise ValueError('Protected zones must be last of the visible ones')
+
+	return rv
+
+
+def gen_str(idx, s, const=True):
+	def sep(i, l):
+		if i == l-1:
+			return ''
+		elif ((i & 7) == 7):
+			return '\n\t\t'
+		else:
+			return ' '
+
+	ll = len(s)
+	d = ''.join(['0x%04x,%s' % (ord(c), sep(j, ll)) for j,c in enumerate(s)])
+	return """static %sstruct usb_str_desc _str%d_desc = {
+	.bLength		= %d,
+	.bDescriptorType	= USB_DT_STR,
+	.wString		= {
+		%s
+	},
+};
+""" % ('const ' if const else '', idx, ll*2+2, d)
+
+
+def gen_conf(name, zones, str_base):
+	# Struct
+	o = []
+	o.append('static const struct {')
+	o.append('\tstruct usb_conf_desc conf;')
+	for alt in range(len(zones)):
+		o.append('\tstruct usb_intf_desc if_%d;' % alt)
+		o.append('\tstruct usb_dfu_desc dfu_%d;' % alt)
+	o.append('#ifdef USB_BENCH')
+	o.append('\tstruct usb_intf_desc if_bench;')
+	o.append('\tstruct usb_ep_desc ep_bench[4];')
+	o.append('#endif')
+	o.append('} __attribute__ ((packed)) %s = {' % name)
+
+	# Config
+	o.append("""	.conf = {
+		.bLength                = sizeof(struct usb_conf_desc),
+		.bDescriptorType        = USB_DT_CONF,
+		.wTotalLength           = sizeof(%s),
+#ifdef USB_BENCH
+		.bNumInterfaces         = 2,
+#else
+		.bNumInterfaces         = 1,
+#endif
+		.bConfigurationValue    = 1,
+		.iConfiguration         = 4,
+		.bmAttributes           = 0x80,
+		.bMaxPower              = 0x32, /* 100 mA */
+	},""" % name)
+
+	# DFU alt settings
+	for alt, z in enumerate(zones):
+		o.append("""	.if_%d = {
+		.bLength		= sizeof(struct usb_intf_desc),
+		.bDescriptorType	= USB_DT_INTF,
+		.bInterfaceNumber	= 0,
+		.bAlternateSetting	= %d,
+		.bNumEndpoints		= 0,
+		.bInterfaceClass	= 0xfe,
+		.bInterfaceSubClass	= 0x01,
+		.bInterfaceProtocol	= 0x02,
+		.iInterface		= %d,
+	},
+	.dfu_%d = {
+		.bLength		= sizeof(struct usb_dfu_desc),
+		.bDescriptorType	= USB_DT_DFU,
+		.bmAttributes		= 0x0d,
+		.wDetachTimeOut		= 1000,
+		.wTransferSize		= %d,
+		.bcdDFUVersion		= 0x0101,
+	},""" % (alt, alt, str_base + alt, alt, z.xfer))
+
+	# Optional benchmark interface
+	o.append('#ifdef USB_BENCH')
+	o.append("""	.if_bench = {
+		.bLength		= sizeof(struct usb_intf_desc),
+		.bDescriptorType	= USB_DT_INTF,
+		.bInterfaceNumber	= USB_BENCH_INTF,
+		.bAlternateSetting	= 0,
+		.bNumEndpoints		= 4,
+		.bInterfaceClass	= 0xff,
+		.bInterfaceSubClass	= 0x00,
+		.bInterfaceProtocol	= 0x00,
+		.iInterface		= 0,
+	},
+	.ep_bench = {""")
+	for ep in ['SINK', 'SOURCE', 'LOOP_OUT', 'LOOP_IN']:
+		o.append("""		{
+			.bLength		= sizeof(struct usb_ep_desc),
+			.bDescriptorType	= USB_DT_EP,
+			.bEndpointAddress	= USB_BENCH_EP_%s,
+			.bmAttributes		= 0x02,
+			.wMaxPacketSize		= USB_BENCH_MPS,
+			.bInterval		= 0x00,
+		},""" % ep)
+	o.append('\t},')
+	o.append('#endif')
+	o.append('};')
+
+	return '\n'.join(o) + '\n'
+
+
+def main(argv0, fn_str, fn_zones, fn_out, board=''):
+	strings = load_strings(fn_str, board)
+	zones   = load_zones(fn_zones)
+
+	z_all = [z for z in zones if 'hidden' not in z.flags]
+	z_wp  = [z for z in z_all if 'protect' not in z.flags]
+
+	str_base = len(strings) + 1
+
+	with open(fn_out, 'w') as fh_out:
+		fh_out.write('/* Generated by usb_gen_dfu.py from %s and %s, do not edit */\n\n' % (fn_str, fn_zones))
+
+		# Zones
+		fh_out.write('const struct dfu_zone dfu_zones[] = {\n')
+		for i, z in enumerate(zones):
+			fh_out.write('\t{ %-18s 0x%08x, 0x%08x, %5d, %s },\t/* %d %s */\n' % (
+				FLASH_SEL[z.flash] + ',', z.start, z.end, z.xfer,
+				'DFU_ZONE_KEEP' if 'keep' in z.flags else '0', i, z.name))
+		fh_out.write('};\n\n')
+		fh_out.write('const int dfu_n_zones = %d;\n\n' % len(zones))
+
+		# Configuration descriptors
+		fh_out.write('\n')
+		fh_out.write(gen_conf('_dfu_conf_desc', z_all, str_base))
+
+		if len(z_wp) != len(z_all):
+			fh_out.write('\n')
+			fh_out.write('/* Same, without the write protected zones */\n')
+			fh_out.write(gen_conf('_dfu_conf_desc_wp', z_wp, str_base))
+		else:
+			fh_out.write('\n#define _dfu_conf_desc_wp _dfu_conf_desc\n')
+
+		fh_out.write('\n')
+		fh_out.write('static const struct usb_conf_desc * const _conf_desc_array[] = {\n')
+		fh_out.write('\t&_dfu_conf_desc.conf,\n')
+		fh_out.write('};\n\n')
+		fh_out.write('static const struct usb_conf_desc * const _conf_desc_wp_array[] = {\n')
+		fh_out.write('\t&_dfu_conf_desc_wp.conf,\n')
+		fh_out.write('};\n\n')
+
+		# Strings
+		str_d = []
+
+		str_d.append("""static const struct usb_str_desc _str0_desc = {
+	.bLength		= 4,
+	.bDescriptorType	= USB_DT_STR,
+	.wString		= { 0x0409 },
+};
+""")
+
+		for i, s in enumerate(strings):
+			str_d.append(gen_str(i+1, s, i != 0))
+
+		for i, z in enumerate(z_all):
+			str_d.append(gen_str(str_base + i, z.label))
+
+		fh_out.write('\n' + '\n'.join(str_d))
+
+		fh_out.write("\n")
+		fh_out.write("static const struct usb_str_desc * const _str_desc_array[] = {\n")
+		for i in range(len(str_d)):
+			fh_out.write("\t& _str%d_desc,\n" % i)
+		fh_out.write("};\n")
+
+if __name__ == '__main__':
+	main(*sys.argv)
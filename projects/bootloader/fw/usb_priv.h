@@ -73,10 +73,26 @@ struct usb_stack {
 
 		uint8_t buf[64];
 
+		int  data_left;		/* Bytes left in the data stage */
+		bool data_wait;		/* Waiting on xfer.cb_data */
+
 		struct usb_xfer xfer;
 		struct usb_ctrl_req req;
 	} ctrl;
 
+	/* Non-control EPs transfer state ([OUT/IN][EP1-15]) */
+	struct usb_ep_state {
+		struct usb_xfer *xfer;	/* Active transfer (NULL if idle) */
+		int ofs_fill;		/* Data offset submitted to BDs */
+		uint16_t mps;		/* Max packet size */
+		uint16_t len[2];	/* Length submitted in each BD */
+		uint8_t n_bd;		/* 1 or 2 if dual buffered */
+		uint8_t n_queued;	/* BDs owned by the hardware, or kept OUT packets */
+		uint8_t bdi_fill;	/* Next BD to submit */
+		uint8_t bdi_done;	/* Next BD to complete */
+		bool zlp;		/* IN: ZLP still needed to end transfer */
+	} ep[2][15];
+
 	/* Function drivers */
 	struct usb_fn_drv *fnd;
 };
@@ -96,7 +112,13 @@ enum usb_fnd_resp usb_dispatch_set_conf(const struct usb_conf_desc *desc);
 enum usb_fnd_resp usb_dispatch_set_intf(const struct usb_intf_desc *base, const struct usb_intf_desc *sel);
 enum usb_fnd_resp usb_dispatch_get_intf(const struct usb_intf_desc *base, uint8_t *sel);
 
+/* EP buffers & transfers */
+void usb_ep_alloc(const struct usb_conf_desc *conf);
+void usb_ep_poll(void);
+
 /* Control */
+#define EP0_PKT_LEN	64
+
 void usb_ep0_reset(void);
 void usb_ep0_poll(void);
 
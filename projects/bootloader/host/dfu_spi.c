@@ -0,0 +1,790 @@
+/*
+ * dfu_spi.c
+ *
+ * Flash read / write tool using raw SPI access to the bootloader flash
+ * (DFU vendor requests), instead of the DFU protocol.
+ *
+ * Only the sectors that differ are touched : the current content is read
+ * back first, erases are grouped into 32k / 64k blocks when possible,
+ * pages that are already right (or all 0xff after an erase) are not
+ * programmed, and sectors where only bits need clearing aren't erased.
+ *
+ * Copyright (C) 2019 Sylvain Munaut
+ * All rights reserved.
+ *
+ * LGPL v3+, see LICENSE.lgpl3
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "dfu_spi.h"
+#include "usb_dfu_vendor.h"
+
+
+#define SECTOR_SIZE	4096
+#define PAGE_SIZE	256
+
+#define FLASH_CMD_WRITE_ENABLE	0x06
+#define FLASH_CMD_READ_SR1	0x05
+#define FLASH_CMD_READ_DATA	0x03
+#define FLASH_CMD_PAGE_PROGRAM	0x02
+#define FLASH_CMD_SECTOR_ERASE	0x20
+#define FLASH_CMD_BLOCK_ERASE_32k	0x52
+#define FLASH_CMD_BLOCK_ERASE_64k	0xd8
+#define FLASH_CMD_READ_JEDEC_ID	0x9f
+#define FLASH_CMD_READ_UNIQUE_ID	0x4b
+
+/* Bootloader zone, see fw/dfu_zones.txt */
+#define PROTECTED_END	0x200000
+
+/* Erases per on-device program, a 64k block erase can take up to 2 s */
+#define PROG_MAX_ERASE	8
+#define PROG_MAX_PATCH	64
+
+
+static struct {
+	uint16_t vid;
+	uint16_t pid;
+	const char *serial;
+	const char *sim;	/* Emulated flash image, instead of a device */
+	uint32_t sim_size;
+	bool dry_run;
+	bool force;
+	bool verify;
+	bool no_prog;
+	bool cart;
+} g_opt = {
+	.vid      = 0x1d50,
+	.pid      = 0x614b,
+	.sim_size = 16 << 20,
+	.verify   = true,
+};
+
+static struct spi_backend *g_be;
+
+static struct {
+	unsigned long bytes_read;
+	unsigned long polls;
+	int erase[3];		/* 4k / 32k / 64k */
+	int sec_skip;
+	int sec_prog;
+	int pages;
+	unsigned long progs;
+} g_stats;
+
+
+/* Utils */
+/* ----- */
+
+static double
+now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static uint8_t *
+load_file(const char *name, uint32_t *len)
+{
+	FILE *fh;
+	uint8_t *buf;
+	long l;
+
+	fh = fopen(name, "rb");
+	if (!fh) {
+		fprintf(stderr, "[!] Can't open %s\n", name);
+		return NULL;
+	}
+
+	fseek(fh, 0, SEEK_END);
+	l = ftell(fh);
+	fseek(fh, 0, SEEK_SET);
+
+	buf = malloc(l ? l : 1);
+	if (fread(buf, 1, l, fh) != (size_t)l) {
+		fprintf(stderr, "[!] Can't read %s\n", name);
+		free(buf);
+		buf = NULL;
+	}
+
+	fclose(fh);
+
+	*len = l;
+	return buf;
+}
+
+static bool
+is_erased(const uint8_t *p, int len)
+{
+	while (len--)
+		if (*p++ != 0xff)
+			return false;
+	return true;
+}
+
+
+/* Flash commands */
+/* -------------- */
+
+static int
+f_cmd_addr(uint8_t *buf, uint8_t cmd, uint32_t addr)
+{
+	buf[0] = cmd;
+	buf[1] = addr >> 16;
+	buf[2] = addr >> 8;
+	buf[3] = addr;
+	return 4;
+}
+
+static int
+f_write_enable(void)
+{
+	uint8_t cmd = FLASH_CMD_WRITE_ENABLE;
+	return g_be->xfer(g_be, &cmd, 1);
+}
+
+static int
+f_wait_ready(void)
+{
+	uint8_t buf[2];
+
+	do {
+		buf[0] = FLASH_CMD_READ_SR1;
+		buf[1] = 0x00;
+		if (g_be->xfer(g_be, buf, 2))
+			return -1;
+		g_stats.polls++;
+	} while (buf[1] & 1);
+
+	return 0;
+}
+
+static int
+f_read(uint32_t addr, uint8_t *dst, uint32_t len)
+{
+	uint8_t *buf = malloc(g_be->max_xfer);
+	int l, rv = 0;
+
+	/* As much as the backend allows per transfer */
+	while (len) {
+		l = g_be->max_xfer - 4;
+		if ((uint32_t)l > len)
+			l = len;
+
+		f_cmd_addr(buf, FLASH_CMD_READ_DATA, addr);
+		memset(&buf[4], 0x00, l);
+
+		rv = g_be->xfer(g_be, buf, l + 4);
+		if (rv)
+			break;
+
+		memcpy(dst, &buf[4], l);
+
+		g_stats.bytes_read += l;
+
+		addr += l;
+		dst  += l;
+		len  -= l;
+	}
+
+	free(buf);
+	return rv;
+}
+
+static int
+f_erase(uint8_t cmd, uint32_t addr)
+{
+	uint8_t buf[4];
+
+	f_cmd_addr(buf, cmd, addr);
+
+	if (f_write_enable() || g_be->xfer(g_be, buf, 4))
+		return -1;
+
+	return f_wait_ready();
+}
+
+static int
+f_page_program(uint32_t addr, const uint8_t *src)
+{
+	uint8_t buf[4 + PAGE_SIZE];
+
+	f_cmd_addr(buf, FLASH_CMD_PAGE_PROGRAM, addr);
+	memcpy(&buf[4], src, PAGE_SIZE);
+
+	if (f_write_enable() || g_be->xfer(g_be, buf, sizeof(buf)))
+		return -1;
+
+	g_stats.pages++;
+
+	return f_wait_ready();
+}
+
+
+/* On-device programs */
+/* ------------------ */
+
+/*
+ * Erases and page programs are batched in SPI_PROG programs, the code
+ * then the page data. DATA arguments are relative to the data while
+ * building, and relocated once the code size is known.
+ */
+static struct {
+	uint8_t *code;
+	int code_len;
+	uint8_t *data;
+	int data_len;
+	int patch[PROG_MAX_PATCH];
+	int n_patch;
+	int n_erase;
+} g_prog;
+
+static bool
+p_room(int code, int data)
+{
+	return (DFU_SPI_PROG_HDR + g_prog.code_len + code + 1 + g_prog.data_len + data) <= g_be->max_xfer;
+}
+
+static void
+p_emit(uint8_t op, uint32_t arg, int arg_len)
+{
+	g_prog.code[g_prog.code_len++] = op;
+	while (arg_len--) {
+		g_prog.code[g_prog.code_len++] = arg;
+		arg >>= 8;
+	}
+}
+
+static void
+p_write_enable(void)
+{
+	p_emit(DFU_SPI_OP_XFER, 1, 2);
+	g_prog.code[g_prog.code_len++] = FLASH_CMD_WRITE_ENABLE;
+}
+
+static void
+p_wait_ready(void)
+{
+	p_emit(DFU_SPI_OP_WAIT, FLASH_CMD_READ_SR1 | (0x01 << 8), 2);
+}
+
+static int
+p_flush(void)
+{
+	uint8_t *buf;
+	int i, ofs, len, rv;
+
+	if (!g_prog.code_len)
+		return 0;
+
+	/* Header, code, END, data */
+	ofs = DFU_SPI_PROG_HDR + g_prog.code_len + 1;
+	len = ofs + g_prog.data_len;
+	buf = calloc(1, len);
+
+	memcpy(&buf[DFU_SPI_PROG_HDR], g_prog.code, g_prog.code_len);
+	buf[ofs - 1] = DFU_SPI_OP_END;
+	memcpy(&buf[ofs], g_prog.data, g_prog.data_len);
+
+	for (i=0; i<g_prog.n_patch; i++) {
+		uint8_t *p = &buf[DFU_SPI_PROG_HDR + g_prog.patch[i]];
+		int v = (p[0] | (p[1] << 8)) + ofs;
+		p[0] = v;
+		p[1] = v >> 8;
+	}
+
+	rv = g_be->prog(g_be, buf, len);
+	if (!rv && buf[0]) {
+		fprintf(stderr, "[!] SPI program error %d at offset %d\n",
+			buf[0], buf[2] | (buf[3] << 8));
+		rv = -1;
+	}
+
+	g_stats.progs++;
+
+	free(buf);
+
+	g_prog.code_len = 0;
+	g_prog.data_len = 0;
+	g_prog.n_patch  = 0;
+	g_prog.n_erase  = 0;
+
+	return rv;
+}
+
+static int
+p_erase(uint8_t cmd, uint32_t addr)
+{
+	/* WREN, ADDR, XFER_A, WAIT */
+	if (((g_prog.n_erase == PROG_MAX_ERASE) || !p_room(16, 0)) && p_flush())
+		return -1;
+
+	p_write_enable();
+	p_emit(DFU_SPI_OP_ADDR, addr, 4);
+	p_emit(DFU_SPI_OP_XFER_A, cmd, 3);
+	p_wait_ready();
+
+	g_prog.n_erase++;
+
+	return 0;
+}
+
+static int
+p_page_program(uint32_t addr, const uint8_t *src, int n)
+{
+	/* DATA, ADDR, LOOP, WREN, XFER_A, WAIT, ADDR_ADD, ENDLOOP */
+	const int code = 28;
+	int k;
+
+	while (n) {
+		k = p_room(code, 0) ? (g_be->max_xfer - DFU_SPI_PROG_HDR - g_prog.code_len - code - 1 - g_prog.data_len) / PAGE_SIZE : 0;
+		if (k > n)
+			k = n;
+
+		if (!k || (g_prog.n_patch == PROG_MAX_PATCH)) {
+			if (!g_prog.code_len || p_flush())
+				return -1;
+			continue;
+		}
+
+		/* One loop over the run of pages */
+		g_prog.patch[g_prog.n_patch++] = g_prog.code_len + 1;
+		p_emit(DFU_SPI_OP_DATA, g_prog.data_len, 2);
+		p_emit(DFU_SPI_OP_ADDR, addr, 4);
+		p_emit(DFU_SPI_OP_LOOP, k, 2);
+		p_write_enable();
+		p_emit(DFU_SPI_OP_XFER_A, FLASH_CMD_PAGE_PROGRAM | (PAGE_SIZE << 8), 3);
+		p_wait_ready();
+		p_emit(DFU_SPI_OP_ADDR_ADD, PAGE_SIZE, 4);
+		p_emit(DFU_SPI_OP_ENDLOOP, 0, 0);
+
+		memcpy(&g_prog.data[g_prog.data_len], src, k * PAGE_SIZE);
+		g_prog.data_len += k * PAGE_SIZE;
+
+		g_stats.pages += k;
+
+		addr += k * PAGE_SIZE;
+		src  += k * PAGE_SIZE;
+		n    -= k;
+	}
+
+	return 0;
+}
+
+
+/* Write planning */
+/* -------------- */
+
+enum sector_action {
+	SA_SKIP = 0,	/* Already right */
+	SA_PROG,	/* Only needs bits cleared, no erase */
+	SA_ERASE,	/* Needs erase then program */
+};
+
+static enum sector_action
+sector_plan(const uint8_t *cur, const uint8_t *tgt)
+{
+	enum sector_action sa = SA_SKIP;
+	int i;
+
+	for (i=0; i<SECTOR_SIZE; i++) {
+		if (cur[i] == tgt[i])
+			continue;
+		if (tgt[i] & ~cur[i])
+			return SA_ERASE;
+		sa = SA_PROG;
+	}
+
+	return sa;
+}
+
+/* Number of sectors covered by the largest erase usable at sector s */
+static int
+erase_span(const enum sector_action *sa, int s, int n_sec, uint32_t base)
+{
+	static const int spans[] = { 16, 8 };
+	uint32_t addr = base + s * SECTOR_SIZE;
+	int i, j;
+
+	for (i=0; i<2; i++) {
+		if ((addr & (spans[i] * SECTOR_SIZE - 1)) || (s + spans[i] > n_sec))
+			continue;
+		for (j=0; j<spans[i]; j++)
+			if (sa[s+j] != SA_ERASE)
+				break;
+		if (j == spans[i])
+			return spans[i];
+	}
+
+	return 1;
+}
+
+static int
+flash_write(uint32_t addr, const uint8_t *data, uint32_t len)
+{
+	uint32_t base = addr & ~(SECTOR_SIZE - 1);
+	uint32_t end  = (addr + len + SECTOR_SIZE - 1) & ~(SECTOR_SIZE - 1);
+	int n_sec = (end - base) / SECTOR_SIZE;
+	enum sector_action *sa;
+	uint8_t *cur, *tgt;
+	int s, p, q, n, span, rv = -1;
+
+	cur = malloc(end - base);
+	tgt = malloc(end - base);
+	sa  = calloc(n_sec, sizeof(enum sector_action));
+
+	if (g_be->prog) {
+		g_prog.code = malloc(g_be->max_xfer);
+		g_prog.data = malloc(g_be->max_xfer);
+	}
+
+	/* Current content, what's outside of the file is kept */
+	printf("Reading current content %06x-%06x\n", base, end - 1);
+	if (f_read(base, cur, end - base))
+		goto out;
+
+	memcpy(tgt, cur, end - base);
+	memcpy(&tgt[addr - base], data, len);
+
+	/* Plan */
+	for (s=0; s<n_sec; s++) {
+		sa[s] = sector_plan(&cur[s * SECTOR_SIZE], &tgt[s * SECTOR_SIZE]);
+		if (sa[s] == SA_SKIP)
+			g_stats.sec_skip++;
+		else if (sa[s] == SA_PROG)
+			g_stats.sec_prog++;
+	}
+
+	/* Erase */
+	for (s=0; s<n_sec; s+=span) {
+		span = 1;
+		if (sa[s] != SA_ERASE)
+			continue;
+
+		span = erase_span(sa, s, n_sec, base);
+
+		if (g_opt.dry_run)
+			printf("  erase %2dk @ %06x\n", span * 4, base + s * SECTOR_SIZE);
+		else if ((g_be->prog ? p_erase : f_erase)(
+				(span == 16) ? FLASH_CMD_BLOCK_ERASE_64k :
+				(span ==  8) ? FLASH_CMD_BLOCK_ERASE_32k :
+				               FLASH_CMD_SECTOR_ERASE, base + s * SECTOR_SIZE))
+			goto out;
+
+		g_stats.erase[(span == 16) ? 2 : ((span == 8) ? 1 : 0)]++;
+
+		memset(&cur[s * SECTOR_SIZE], 0xff, span * SECTOR_SIZE);
+	}
+
+	/* Program the pages that differ and aren't all 0xff, by runs */
+	for (p=0; p<(int)(end - base); p+=n*PAGE_SIZE) {
+		for (n=0; (p + n*PAGE_SIZE) < (int)(end - base); n++) {
+			q = p + n*PAGE_SIZE;
+			if (!memcmp(&cur[q], &tgt[q], PAGE_SIZE) || is_erased(&tgt[q], PAGE_SIZE))
+				break;
+		}
+
+		if (!n) {
+			n = 1;
+			continue;
+		}
+
+		if (g_opt.dry_run)
+			g_stats.pages += n;
+		else if (g_be->prog) {
+			if (p_page_program(base + p, &tgt[p], n))
+				goto out;
+		} else {
+			for (q=0; q<n; q++)
+				if (f_page_program(base + p + q*PAGE_SIZE, &tgt[p + q*PAGE_SIZE]))
+					goto out;
+		}
+	}
+
+	if (g_be->prog && p_flush())
+		goto out;
+
+	/* Verify what was touched */
+	rv = 0;
+
+	if (!g_opt.verify || g_opt.dry_run)
+		goto out;
+
+	printf("Verifying\n");
+
+	for (s=0; s<n_sec; s++) {
+		if (sa[s] == SA_SKIP)
+			continue;
+
+		if (f_read(base + s * SECTOR_SIZE, &cur[s * SECTOR_SIZE], SECTOR_SIZE)) {
+			rv = -1;
+			break;
+		}
+
+		if (memcmp(&cur[s * SECTOR_SIZE], &tgt[s * SECTOR_SIZE], SECTOR_SIZE)) {
+			fprintf(stderr, "[!] Verify error in sector @ %06x (write protected ?)\n",
+				base + s * SECTOR_SIZE);
+			rv = -1;
+		}
+	}
+
+out:
+	free(g_prog.data);
+	free(g_prog.code);
+	memset(&g_prog, 0x00, sizeof(g_prog));
+
+	free(sa);
+	free(tgt);
+	free(cur);
+
+	return rv;
+}
+
+
+/* Commands */
+/* -------- */
+
+static int
+cmd_id(void)
+{
+	uint8_t buf[13];
+	int i;
+
+	memset(buf, 0x00, sizeof(buf));
+	buf[0] = FLASH_CMD_READ_JEDEC_ID;
+	if (g_be->xfer(g_be, buf, 4))
+		return -1;
+	printf("JEDEC ID  : %02x %02x %02x\n", buf[1], buf[2], buf[3]);
+
+	memset(buf, 0x00, sizeof(buf));
+	buf[0] = FLASH_CMD_READ_UNIQUE_ID;
+	if (g_be->xfer(g_be, buf, 13))
+		return -1;
+	printf("Unique ID : ");
+	for (i=5; i<13; i++)
+		printf("%02x", buf[i]);
+	printf("\n");
+
+	printf("Requests  : %s\n", g_be->prog ? "SPI_PROG" : "SPI_EXEC");
+
+	return 0;
+}
+
+static int
+cmd_read(uint32_t addr, uint32_t len, const char *name)
+{
+	uint8_t *buf = malloc(len ? len : 1);
+	FILE *fh;
+	int rv;
+
+	rv = f_read(addr, buf, len);
+	if (!rv) {
+		fh = fopen(name, "wb");
+		if (!fh || (fwrite(buf, 1, len, fh) != len)) {
+			fprintf(stderr, "[!] Can't write %s\n", name);
+			rv = -1;
+		}
+		if (fh)
+			fclose(fh);
+	}
+
+	free(buf);
+	return rv;
+}
+
+static int
+cmd_write(uint32_t addr, const char *name, bool verify_only)
+{
+	uint8_t *data, *cur;
+	uint32_t len;
+	int rv;
+
+	data = load_file(name, &len);
+	if (!data)
+		return -1;
+
+	if ((addr < PROTECTED_END) && !verify_only && !g_opt.force && !g_opt.cart) {
+		fprintf(stderr, "[!] %06x is in the bootloader zone, use -F to write there\n", addr);
+		free(data);
+		return -1;
+	}
+
+	if (!verify_only) {
+		rv = flash_write(addr, data, len);
+	} else {
+		cur = malloc(len ? len : 1);
+		rv = f_read(addr, cur, len);
+		if (!rv && memcmp(cur, data, len)) {
+			fprintf(stderr, "[!] Flash content differs from %s\n", name);
+			rv = -1;
+		}
+		free(cur);
+	}
+
+	free(data);
+	return rv;
+}
+
+
+/* Main */
+/* ---- */
+
+/* Through SPI_PROG, the selection stays until DFU changes it */
+static int
+select_flash(int sel)
+{
+	uint8_t buf[DFU_SPI_PROG_HDR + 3] = { 0 };
+
+	if (!g_be->prog) {
+		fprintf(stderr, "[!] Selecting the cart flash needs SPI_PROG\n");
+		return -1;
+	}
+
+	buf[DFU_SPI_PROG_HDR + 0] = DFU_SPI_OP_FLASH;
+	buf[DFU_SPI_PROG_HDR + 1] = sel;
+	buf[DFU_SPI_PROG_HDR + 2] = DFU_SPI_OP_END;
+
+	if (g_be->prog(g_be, buf, sizeof(buf)) || buf[0])
+		return -1;
+
+	return 0;
+}
+
+static void
+usage(const char *argv0)
+{
+	fprintf(stderr,
+		"Usage: %s [options] command ...\n"
+		"  -d vid:pid  Device to use (default %04x:%04x)\n"
+		"  -S serial   Device serial number (flash unique ID)\n"
+		"  -f file     Use an emulated flash stored in file instead of a device\n"
+		"  -n          Dry run, only print the write plan\n"
+		"  -F          Allow writes in the bootloader zone (below %06x)\n"
+		"  -V          Don't verify after write\n"
+		"  -P          Don't use on-device programs, one request per SPI transfer\n"
+		"  -c          Use the cart flash (needs on-device programs)\n"
+		"Commands:\n"
+		"  id\n"
+		"  read    addr len file\n"
+		"  write   addr file\n"
+		"  verify  addr file\n"
+		"Without -c, the active flash chip is the one last used by DFU (internal after boot).\n",
+		argv0, g_opt.vid, g_opt.pid, PROTECTED_END);
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned int vid, pid;
+	double t;
+	char **cmd;
+	int n_cmd;
+	int rv, opt;
+
+	while ((opt = getopt(argc, argv, "d:S:f:nFVPch")) != -1) {
+		switch (opt) {
+		case 'd':
+			if (sscanf(optarg, "%x:%x", &vid, &pid) != 2) {
+				usage(argv[0]);
+				return 1;
+			}
+			g_opt.vid = vid;
+			g_opt.pid = pid;
+			break;
+		case 'S': g_opt.serial  = optarg; break;
+		case 'f': g_opt.sim     = optarg; break;
+		case 'n': g_opt.dry_run = true;   break;
+		case 'F': g_opt.force   = true;   break;
+		case 'V': g_opt.verify  = false;  break;
+		case 'P': g_opt.no_prog = true;   break;
+		case 'c': g_opt.cart    = true;   break;
+		default:
+			usage(argv[0]);
+			return opt == 'h' ? 0 : 1;
+		}
+	}
+
+	cmd   = &argv[optind];
+	n_cmd = argc - optind;
+
+	if ((n_cmd < 1) ||
+	    (!strcmp(cmd[0], "id")     && (n_cmd != 1)) ||
+	    (!strcmp(cmd[0], "read")   && (n_cmd != 4)) ||
+	    (!strcmp(cmd[0], "write")  && (n_cmd != 3)) ||
+	    (!strcmp(cmd[0], "verify") && (n_cmd != 3))) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	/* Backend */
+	if (g_opt.sim)
+		g_be = spi_sim_open(g_opt.sim, g_opt.sim_size);
+	else
+		g_be = spi_usb_open(g_opt.vid, g_opt.pid, g_opt.serial);
+
+	if (!g_be)
+		return 1;
+
+	if (g_opt.no_prog)
+		g_be->prog = NULL;
+
+	/* Run */
+	t = now();
+
+	rv = 0;
+
+	if (g_opt.cart && (rv = select_flash(1)))
+		;
+	else if (!strcmp(cmd[0], "id"))
+		rv = cmd_id();
+	else if (!strcmp(cmd[0], "read"))
+		rv = cmd_read(strtoul(cmd[1], NULL, 0), strtoul(cmd[2], NULL, 0), cmd[3]);
+	else if (!strcmp(cmd[0], "write"))
+		rv = cmd_write(strtoul(cmd[1], NULL, 0), cmd[2], false);
+	else if (!strcmp(cmd[0], "verify"))
+		rv = cmd_write(strtoul(cmd[1], NULL, 0), cmd[2], true);
+	else {
+		usage(argv[0]);
+		rv = -1;
+	}
+
+	if (g_opt.cart)
+		select_flash(0);
+
+	t = now() - t;
+
+	/* Report */
+	if (!strcmp(cmd[0], "write"))
+		printf("Sectors : %d unchanged, %d program only, erased %d x 4k %d x 32k %d x 64k\n"
+		       "Pages   : %d programmed\n",
+			g_stats.sec_skip, g_stats.sec_prog,
+			g_stats.erase[0], g_stats.erase[1], g_stats.erase[2],
+			g_stats.pages);
+
+	printf("%s: %.2f s, %lu requests (%lu programs, %lu status polls), %lu bytes read\n",
+		rv ? "Failed" : "Done", t, g_be->n_xfer, g_stats.progs, g_stats.polls, g_stats.bytes_read);
+
+	g_be->close(g_be);
+
+	return rv ? 1 : 0;
+}
@@ -0,0 +1,55 @@
+/*
+ * dfu_spi.h
+ *
+ * Raw SPI flash access backends for dfu_spi
+ *
+ * Copyright (C) 2019 Sylvain Munaut
+ * All rights reserved.
+ *
+ * LGPL v3+, see LICENSE.lgpl3
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+/*
+ * A backend runs CS framed, full duplex, SPI transfers on the flash of
+ * a target, the received bytes replacing the sent ones in buf.
+ */
+struct spi_backend {
+	const char *name;
+	int max_xfer;		/* Max length of a single transfer */
+
+	int  (*xfer)(struct spi_backend *be, uint8_t *buf, int len);
+	void (*close)(struct spi_backend *be);
+
+	/*
+	 * Optional, runs a SPI_PROG program (see usb_dfu_vendor.h) of up to
+	 * max_xfer bytes, buf then holds the status and the received bytes
+	 */
+	int  (*prog)(struct spi_backend *be, uint8_t *buf, int len);
+
+	/* Stats */
+	unsigned long n_xfer;
+};
+
+/* Bootloader, through the SPI_EXEC / SPI_RESULT DFU vendor requests */
+struct spi_backend *spi_usb_open(uint16_t vid, uint16_t pid, const char *serial);
+
+/* Emulated SPI NOR flash in a file, for offline runs and tests */
+struct spi_backend *spi_sim_open(const char *path, uint32_t size);
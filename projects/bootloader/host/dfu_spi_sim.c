@@ -0,0 +1,243 @@
+/*
+ * dfu_spi_sim.c
+ *
+ * dfu_spi backend emulating a SPI NOR flash (W25Q128 like) in a file
+ *
+ * Copyright (C) 2019 Sylvain Munaut
+ * All rights reserved.
+ *
+ * LGPL v3+, see LICENSE.lgpl3
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dfu_spi.h"
+#include "spi_prog.h"
+
+
+/* Status polls a write / erase stays busy for, to exercise the waits */
+#define BUSY_POLLS_PROG		1
+#define BUSY_POLLS_ERASE	4
+
+
+struct spi_sim {
+	struct spi_backend be;
+	const char *path;
+	uint8_t *mem;
+	uint32_t size;
+	bool wel;
+	int busy;
+};
+
+
+static uint32_t
+sim_addr(struct spi_sim *ss, const uint8_t *buf)
+{
+	return ((buf[1] << 16) | (buf[2] << 8) | buf[3]) & (ss->size - 1);
+}
+
+static void
+sim_erase(struct spi_sim *ss, uint32_t addr, uint32_t len)
+{
+	addr &= ~(len - 1);
+	memset(&ss->mem[addr], 0xff, len);
+}
+
+static int
+spi_sim_xfer(struct spi_backend *be, uint8_t *buf, int len)
+{
+	struct spi_sim *ss = (struct spi_sim *)be;
+	uint8_t cmd = buf[0];
+	uint32_t addr;
+	int i;
+
+	be->n_xfer++;
+
+	if (len < 1)
+		return 0;
+
+	/* Only the status register can be read while busy */
+	if (ss->busy && (cmd != 0x05)) {
+		memset(buf, 0xff, len);
+		return 0;
+	}
+
+	switch (cmd)
+	{
+	case 0x05: /* Read SR1 */
+		for (i=1; i<len; i++)
+			buf[i] = (ss->busy ? 0x01 : 0x00) | (ss->wel ? 0x02 : 0x00);
+		if (ss->busy)
+			ss->busy--;
+		break;
+
+	case 0x06: /* Write enable */
+		ss->wel = true;
+		break;
+
+	case 0x04: /* Write disable */
+		ss->wel = false;
+		break;
+
+	case 0x9f: /* JEDEC ID */
+		for (i=1; i<len; i++)
+			buf[i] = (i < 4) ? (uint8_t[]){ 0xef, 0x40, 0x18 }[i-1] : 0xff;
+		break;
+
+	case 0x4b: /* Unique ID, after 4 dummy bytes */
+		for (i=5; i<len; i++)
+			buf[i] = 0x50 + i - 5;
+		break;
+
+	case 0x03: /* Read data */
+		if (len < 4)
+			break;
+		addr = sim_addr(ss, buf);
+		for (i=4; i<len; i++)
+			buf[i] = ss->mem[(addr + i - 4) & (ss->size - 1)];
+		break;
+
+	case 0x02: /* Page program, wraps in the page, can only clear bits */
+		if ((len < 4) || !ss->wel)
+			break;
+		addr = sim_addr(ss, buf);
+		for (i=4; i<len; i++)
+			ss->mem[(addr & ~0xff) | ((addr + i - 4) & 0xff)] &= buf[i];
+		ss->wel  = false;
+		ss->busy = BUSY_POLLS_PROG;
+		break;
+
+	case 0x20: /* Sector erase */
+	case 0x52: /* Block erase 32k */
+	case 0xd8: /* Block erase 64k */
+		if ((len < 4) || !ss->wel)
+			break;
+		sim_erase(ss, sim_addr(ss, buf), (cmd == 0x20) ? 0x1000 : ((cmd == 0x52) ? 0x8000 : 0x10000));
+		ss->wel  = false;
+		ss->busy = BUSY_POLLS_ERASE;
+		break;
+
+	default:
+		/* Ignored, like unknown commands on a real chip */
+		break;
+	}
+
+	return 0;
+}
+
+/* spi_prog_ops have no context, only one emulated flash at a time */
+static struct spi_sim *g_sim;
+
+static void
+spi_sim_prog_xfer(unsigned cs, uint8_t *hdr, unsigned hdr_len, uint8_t *data, unsigned len)
+{
+	uint8_t *buf;
+
+	/* Only the flash is emulated */
+	if (cs != 0)
+		return;
+
+	buf = malloc(hdr_len + len);
+	memcpy(buf, hdr, hdr_len);
+	memcpy(&buf[hdr_len], data, len);
+
+	spi_sim_xfer(&g_sim->be, buf, hdr_len + len);
+
+	memcpy(hdr, buf, hdr_len);
+	memcpy(data, &buf[hdr_len], len);
+
+	free(buf);
+}
+
+static void
+spi_sim_prog_flash_sel(int sel)
+{
+	/* Single chip */
+}
+
+static const struct spi_prog_ops spi_sim_prog_ops = {
+	.xfer      = spi_sim_prog_xfer,
+	.flash_sel = spi_sim_prog_flash_sel,
+};
+
+static int
+spi_sim_prog(struct spi_backend *be, uint8_t *buf, int len)
+{
+	unsigned long n_xfer = be->n_xfer;
+
+	/* Same interpreter as the firmware, counts as a single request */
+	g_sim = (struct spi_sim *)be;
+	spi_prog_run(&spi_sim_prog_ops, buf, len);
+
+	be->n_xfer = n_xfer + 1;
+
+	return 0;
+}
+
+static void
+spi_sim_close(struct spi_backend *be)
+{
+	struct spi_sim *ss = (struct spi_sim *)be;
+	FILE *fh;
+
+	fh = fopen(ss->path, "wb");
+	if (!fh || (fwrite(ss->mem, 1, ss->size, fh) != ss->size))
+		fprintf(stderr, "[!] Failed to save flash image to %s\n", ss->path);
+	if (fh)
+		fclose(fh);
+
+	free(ss->mem);
+	free(ss);
+}
+
+struct spi_backend *
+spi_sim_open(const char *path, uint32_t size)
+{
+	struct spi_sim *ss;
+	FILE *fh;
+
+	if (size & (size - 1)) {
+		fprintf(stderr, "[!] Emulated flash size must be a power of 2\n");
+		return NULL;
+	}
+
+	ss = calloc(1, sizeof(struct spi_sim));
+	ss->path = path;
+	ss->size = size;
+	ss->mem  = malloc(size);
+
+	/* Erased flash, with the file content if there is one */
+	memset(ss->mem, 0xff, size);
+
+	fh = fopen(path, "rb");
+	if (fh) {
+		if (fread(ss->mem, 1, size, fh) == 0)
+			fprintf(stderr, "[w] %s is empty, starting from an erased flash\n", path);
+		fclose(fh);
+	}
+
+	ss->be.name     = "sim";
+	ss->be.max_xfer = 8192;
+	ss->be.xfer     = spi_sim_xfer;
+	ss->be.close    = spi_sim_close;
+	ss->be.prog     = spi_sim_prog;
+
+	return &ss->be;
+}
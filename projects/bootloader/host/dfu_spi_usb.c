@@ -0,0 +1,213 @@
+/*
+ * dfu_spi_usb.c
+ *
+ * dfu_spi backend using the bootloader DFU vendor requests
+ *
+ * Copyright (C) 2019 Sylvain Munaut
+ * All rights reserved.
+ *
+ * LGPL v3+, see LICENSE.lgpl3
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libusb.h>
+
+#include "dfu_spi.h"
+#include "usb_dfu_vendor.h"
+
+
+#define DFU_INTF	0
+#define TIMEOUT_MS	5000
+#define PROG_TIMEOUT_MS	30000	/* Programs can do several block erases */
+
+
+struct spi_usb {
+	struct spi_backend be;
+	libusb_device_handle *devh;
+};
+
+
+static int
+spi_usb_xfer(struct spi_backend *be, uint8_t *buf, int len)
+{
+	struct spi_usb *su = (struct spi_usb *)be;
+	int rv;
+
+	/* Execute */
+	rv = libusb_control_transfer(su->devh,
+		USB_RT_DFU_VENDOR_SPI_EXEC & 0xff, USB_RT_DFU_VENDOR_SPI_EXEC >> 8,
+		0, DFU_INTF, buf, len, TIMEOUT_MS);
+	if (rv != len)
+		goto err;
+
+	/* Read back what was received */
+	rv = libusb_control_transfer(su->devh,
+		USB_RT_DFU_VENDOR_SPI_RESULT & 0xff, USB_RT_DFU_VENDOR_SPI_RESULT >> 8,
+		0, DFU_INTF, buf, len, TIMEOUT_MS);
+	if (rv != len)
+		goto err;
+
+	be->n_xfer++;
+
+	return 0;
+
+err:
+	fprintf(stderr, "[!] SPI transfer failed: %s\n",
+		rv < 0 ? libusb_error_name(rv) : "short transfer");
+	return -1;
+}
+
+static int
+spi_usb_prog(struct spi_backend *be, uint8_t *buf, int len)
+{
+	struct spi_usb *su = (struct spi_usb *)be;
+	int rv;
+
+	/* The device doesn't answer until the program is done */
+	rv = libusb_control_transfer(su->devh,
+		USB_RT_DFU_VENDOR_SPI_PROG & 0xff, USB_RT_DFU_VENDOR_SPI_PROG >> 8,
+		0, DFU_INTF, buf, len, PROG_TIMEOUT_MS);
+	if (rv != len)
+		goto err;
+
+	rv = libusb_control_transfer(su->devh,
+		USB_RT_DFU_VENDOR_SPI_RESULT & 0xff, USB_RT_DFU_VENDOR_SPI_RESULT >> 8,
+		0, DFU_INTF, buf, len, PROG_TIMEOUT_MS);
+	if (rv != len)
+		goto err;
+
+	be->n_xfer++;
+
+	return 0;
+
+err:
+	fprintf(stderr, "[!] SPI program failed: %s\n",
+		rv < 0 ? libusb_error_name(rv) : "short transfer");
+	return -1;
+}
+
+static void
+spi_usb_close(struct spi_backend *be)
+{
+	struct spi_usb *su = (struct spi_usb *)be;
+
+	libusb_release_interface(su->devh, DFU_INTF);
+	libusb_close(su->devh);
+	libusb_exit(NULL);
+	free(su);
+}
+
+static libusb_device_handle *
+spi_usb_find(uint16_t vid, uint16_t pid, const char *serial)
+{
+	libusb_device **list;
+	libusb_device_handle *devh = NULL;
+	struct libusb_device_descriptor desc;
+	char str[64];
+	ssize_t n;
+	int i;
+
+	n = libusb_get_device_list(NULL, &list);
+	if (n < 0)
+		return NULL;
+
+	for (i=0; i<n; i++) {
+		if (libusb_get_device_descriptor(list[i], &desc))
+			continue;
+
+		if ((desc.idVendor != vid) || (desc.idProduct != pid))
+			continue;
+
+		if (libusb_open(list[i], &devh))
+			continue;
+
+		if (!serial)
+			break;
+
+		if ((libusb_get_string_descriptor_ascii(devh, desc.iSerialNumber,
+				(unsigned char *)str, sizeof(str)) > 0) && !strcmp(str, serial))
+			break;
+
+		libusb_close(devh);
+		devh = NULL;
+	}
+
+	libusb_free_device_list(list, 1);
+
+	return devh;
+}
+
+struct spi_backend *
+spi_usb_open(uint16_t vid, uint16_t pid, const char *serial)
+{
+	struct spi_usb *su;
+	uint8_t ver[2];
+	int rv;
+
+	rv = libusb_init(NULL);
+	if (rv) {
+		fprintf(stderr, "[!] libusb init failed: %s\n", libusb_error_name(rv));
+		return NULL;
+	}
+
+	su = calloc(1, sizeof(struct spi_usb));
+
+	su->devh = spi_usb_find(vid, pid, serial);
+	if (!su->devh) {
+		fprintf(stderr, "[!] Device %04x:%04x%s%s not found\n", vid, pid,
+			serial ? " serial " : "", serial ? serial : "");
+		goto err_exit;
+	}
+
+	rv = libusb_claim_interface(su->devh, DFU_INTF);
+	if (rv) {
+		fprintf(stderr, "[!] Can't claim the DFU interface: %s\n", libusb_error_name(rv));
+		goto err_close;
+	}
+
+	/* Check the vendor requests are there */
+	rv = libusb_control_transfer(su->devh,
+		USB_RT_DFU_VENDOR_VERSION & 0xff, USB_RT_DFU_VENDOR_VERSION >> 8,
+		0, DFU_INTF, ver, 2, TIMEOUT_MS);
+	if (rv != 2) {
+		fprintf(stderr, "[!] No DFU vendor requests support (not the bootloader ?)\n");
+		goto err_release;
+	}
+
+	su->be.name     = "usb";
+	su->be.max_xfer = DFU_VENDOR_BUF_SIZE;
+	su->be.xfer     = spi_usb_xfer;
+	su->be.close    = spi_usb_close;
+
+	/* Older bootloaders only have SPI_EXEC */
+	if ((ver[0] | (ver[1] << 8)) >= 2)
+		su->be.prog = spi_usb_prog;
+
+	return &su->be;
+
+err_release:
+	libusb_release_interface(su->devh, DFU_INTF);
+err_close:
+	libusb_close(su->devh);
+err_exit:
+	free(su);
+	libusb_exit(NULL);
+	return NULL;
+}
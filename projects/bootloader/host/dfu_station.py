@@ -0,0 +1,252 @@
+#!/usr/bin/env python3
+
+#
+# Flashes all the connected bootloaders at once, one worker per device,
+# for production stations.
+#
+# Usage: dfu_station.py [-d vid:pid,...] [-S serial,...] [-j jobs]
+#                       [-n] [-F] [-R] [-o report.csv] addr file [addr file ...]
+#
+# Devices are found with 'dfu-util -l' and told apart by their serial
+# number (the flash unique ID, see serial_no_init() in fw/fw_dfu.c).
+# Each one is then written with the fastest transport it has :
+#
+#  - dfu_spi, with on-device programs (SPI_PROG) or one request per SPI
+#    transfer (SPI_EXEC), which only touches what differs and verifies
+#    what it wrote
+#  - dfu-util otherwise, for images starting at a zone of
+#    fw/dfu_zones.txt, verified by reading them back (UPLOAD)
+#
+# -n only lists the devices and their transport, -F allows writes in the
+# bootloader zone (dfu_spi only), -R starts the user bitstream on the
+# devices that were written successfully. A report with the time and
+# result of each device is printed at the end, and saved as CSV with -o.
+#
+
+import concurrent.futures
+import csv
+import getopt
+import os
+import re
+import subprocess
+import sys
+import tempfile
+import time
+
+
+HOST_DIR  = os.path.dirname(os.path.abspath(__file__))
+DFU_SPI   = os.path.join(HOST_DIR, 'dfu_spi')
+DFU_ZONES = os.path.join(HOST_DIR, '..', 'fw', 'dfu_zones.txt')
+DFU_UTIL  = os.environ.get('DFU_UTIL', 'dfu-util')
+
+DEV_IDS   = [ '1d50:614b', '1d50:614a' ]
+
+
+def run(args):
+	p = subprocess.run(args, stdout=subprocess.PIPE, stderr=subprocess.STDOUT, universal_newlines=True)
+	return p.returncode, p.stdout
+
+
+def load_zones():
+	# Alt setting -> (flash, start, end), see usb_gen_dfu.py
+	zones = []
+	with open(DFU_ZONES, 'r') as fh:
+		for l in fh:
+			l = l.strip()
+			if not l or l.startswith('#'):
+				continue
+			f = l.split(None, 5)
+			zones.append((f[0], int(f[1], 0), int(f[2], 0)))
+	return zones
+
+
+class Device:
+
+	def __init__(self, dev_id, serial, path):
+		self.dev_id    = dev_id
+		self.serial    = serial
+		self.path      = path
+		self.transport = None
+		self.result    = 'not run'
+		self.detail    = ''
+		self.time      = 0.0
+		self.ok        = False
+
+	def dfu_spi(self, *args):
+		return run([ DFU_SPI, '-d', self.dev_id, '-S', self.serial ] + list(args))
+
+	def dfu_util(self, *args):
+		return run([ DFU_UTIL, '-d', self.dev_id, '-S', self.serial ] + list(args))
+
+
+def discover(dev_ids, serials):
+	rv, out = run([ DFU_UTIL, '-l' ])
+
+	devs = {}
+	for m in re.finditer(r'Found DFU: \[([0-9a-f]{4}:[0-9a-f]{4})\].*?path="([^"]*)".*?serial="([^"]*)"', out):
+		dev_id, path, serial = m.groups()
+		if (dev_id not in dev_ids) or (serials and serial not in serials):
+			continue
+		# One line per alt setting
+		devs.setdefault(serial, Device(dev_id, serial, path))
+
+	return sorted(devs.values(), key=lambda d: d.path)
+
+
+def probe(dev):
+	# SPI_PROG / SPI_EXEC if the vendor requests are there
+	if os.path.exists(DFU_SPI):
+		rv, out = dev.dfu_spi('id')
+		m = re.search(r'Requests\s*:\s*(\S+)', out)
+		if not rv and m:
+			dev.transport = 'dfu_spi/' + m.group(1)
+			return
+
+	dev.transport = 'dfu-util'
+
+
+def flash_dfu_spi(dev, images, force):
+	for addr, name in images:
+		rv, out = dev.dfu_spi(*([ '-F' ] if force else []), 'write', '0x%x' % addr, name)
+		if rv:
+			err = [ l for l in out.splitlines() if l.startswith('[!]') ]
+			return 'verify error' if any('Verify' in l for l in err) else 'write error', (err or [ 'failed' ])[-1]
+	return 'ok', ''
+
+
+def flash_dfu_util(dev, images, zones):
+	for addr, name in images:
+		alt = [ i for i, z in enumerate(zones) if (z[0] == 'internal') and (z[1] == addr) ]
+		if not alt:
+			return 'error', 'no DFU zone starts at 0x%x' % addr
+
+		rv, out = dev.dfu_util('-a', str(alt[0]), '-D', name)
+		if rv:
+			return 'write error', out.strip().splitlines()[-1]
+
+		# Read back what was written
+		size = os.path.getsize(name)
+		with tempfile.TemporaryDirectory() as tmp:
+			rb = os.path.join(tmp, 'readback.bin')
+			rv, out = dev.dfu_util('-a', str(alt[0]), '-U', rb, '-Z', str(size))
+			with open(name, 'rb') as fh:
+				ref = fh.read()
+			if rv or not os.path.exists(rb):
+				return 'verify error', 'read back failed'
+			with open(rb, 'rb') as fh:
+				if fh.read(size) != ref:
+					return 'verify error', 'content differs'
+
+	return 'ok', ''
+
+
+def worker(dev, images, zones, force, reboot):
+	t = time.time()
+
+	probe(dev)
+
+	if dev.transport.startswith('dfu_spi'):
+		dev.result, dev.detail = flash_dfu_spi(dev, images, force)
+	else:
+		dev.result, dev.detail = flash_dfu_util(dev, images, zones)
+
+	dev.ok   = dev.result == 'ok'
+	dev.time = time.time() - t
+
+	if dev.ok and reboot:
+		dev.dfu_util('-a', '0', '-e')
+
+	sys.stderr.write('[%s] %s %s (%.1f s)\n' % (dev.serial, dev.result, dev.detail, dev.time))
+
+	return dev
+
+
+def report(devs, csv_name):
+	print('%-18s %-10s %-12s %-16s %8s  %s' % ('Serial', 'Device', 'Path', 'Transport', 'Time', 'Result'))
+	for d in devs:
+		print('%-18s %-10s %-12s %-16s %7.1fs  %s%s' % (d.serial, d.dev_id, d.path, d.transport or '-',
+			d.time, d.result, (' : ' + d.detail) if d.detail else ''))
+
+	n_ok = sum(d.ok for d in devs)
+	print('%d / %d devices ok' % (n_ok, len(devs)))
+
+	if csv_name:
+		with open(csv_name, 'w', newline='') as fh:
+			w = csv.writer(fh)
+			w.writerow([ 'serial', 'device', 'path', 'transport', 'time', 'result', 'detail' ])
+			for d in devs:
+				w.writerow([ d.serial, d.dev_id, d.path, d.transport, '%.2f' % d.time, d.result, d.detail ])
+
+	return n_ok == len(devs)
+
+
+def usage(argv0):
+	sys.stderr.write('Usage: %s [-d vid:pid,...] [-S serial,...] [-j jobs] [-n] [-F] [-R] [-o report.csv] addr file [addr file ...]\n' % argv0)
+	return 1
+
+
+def main(argv0, *args):
+	dev_ids = DEV_IDS
+	serials = None
+	jobs    = None
+	list_only = False
+	force   = False
+	reboot  = False
+	csv_name = None
+
+	try:
+		opts, args = getopt.getopt(args, 'd:S:j:nFRo:h')
+	except getopt.GetoptError:
+		return usage(argv0)
+
+	for o, v in opts:
+		if o == '-d':
+			dev_ids = v.split(',')
+		elif o == '-S':
+			serials = v.split(',')
+		elif o == '-j':
+			jobs = int(v)
+		elif o == '-n':
+			list_only = True
+		elif o == '-F':
+			force = True
+		elif o == '-R':
+			reboot = True
+		elif o == '-o':
+			csv_name = v
+		else:
+			return usage(argv0)
+
+	if (len(args) & 1) or (not args and not list_only):
+		return usage(argv0)
+
+	images = [ (int(args[i], 0), args[i+1]) for i in range(0, len(args), 2) ]
+	for _, name in images:
+		if not os.path.isfile(name):
+			sys.stderr.write('[!] Can\'t open %s\n' % name)
+			return 1
+
+	zones = load_zones()
+	devs  = discover(dev_ids, serials)
+
+	if not devs:
+		sys.stderr.write('[!] No device found\n')
+		return 1
+
+	if list_only:
+		for d in devs:
+			probe(d)
+			print('%-18s %-10s %-12s %s' % (d.serial, d.dev_id, d.path, d.transport))
+		return 0
+
+	sys.stderr.write('Flashing %d devices\n' % len(devs))
+
+	# Each device is its own process (dfu_spi / dfu-util), threads only wait
+	with concurrent.futures.ThreadPoolExecutor(jobs or len(devs)) as pool:
+		list(pool.map(lambda d: worker(d, images, zones, force, reboot), devs))
+
+	return 0 if report(devs, csv_name) else 1
+
+
+if __name__ == '__main__':
+	sys.exit(main(*sys.argv))
@@ -0,0 +1,448 @@
+/*
+ * usb_bench.c
+ *
+ * Host side of the USB benchmark function (fw/usb_bench.c)
+ *
+ * Measures the sustained BULK OUT / IN throughput and the loopback
+ * round trip latency of the device.
+ *
+ * Copyright (C) 2019 Sylvain Munaut
+ * All rights reserved.
+ *
+ * LGPL v3+, see LICENSE.lgpl3
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <libusb.h>
+
+#include "usb_bench.h"
+
+
+#define MAX_QUEUE	32
+#define TIMEOUT_MS	2000
+
+
+static struct {
+	uint16_t vid;
+	uint16_t pid;
+	int xfer_len;		/* Size of each transfer for sink/source */
+	int queue;		/* Number of transfers in flight */
+	int total_kb;		/* Amount of data for sink/source */
+	int loop_iter;		/* Number of loopback round trips per size */
+	bool check;		/* Check source / loopback data */
+} g_opt = {
+	.vid       = 0x1d50,
+	.pid       = 0x614b,
+	.xfer_len  = 16384,
+	.queue     = 4,
+	.total_kb  = 4096,
+	.loop_iter = 1000,
+	.check     = true,
+};
+
+
+/* Utils */
+/* ----- */
+
+static double
+now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static uint32_t
+get_le32(const uint8_t *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+struct lat_stats {
+	double min, max, sum;
+	int n;
+};
+
+static void
+lat_add(struct lat_stats *ls, double v)
+{
+	if (!ls->n || (v < ls->min)) ls->min = v;
+	if (!ls->n || (v > ls->max)) ls->max = v;
+	ls->sum += v;
+	ls->n++;
+}
+
+static void
+lat_print(const char *name, struct lat_stats *ls)
+{
+	if (!ls->n)
+		return;
+	printf("  %-22s min %8.1f us   avg %8.1f us   max %8.1f us\n",
+		name, ls->min * 1e6, ls->sum * 1e6 / ls->n, ls->max * 1e6);
+}
+
+
+/* Device stats */
+/* ------------ */
+
+static int
+stats_reset(libusb_device_handle *devh)
+{
+	return libusb_control_transfer(devh,
+		USB_RT_BENCH_RESET & 0xff, USB_RT_BENCH_RESET >> 8,
+		0, USB_BENCH_INTF, NULL, 0, TIMEOUT_MS);
+}
+
+static int
+stats_print(libusb_device_handle *devh)
+{
+	uint8_t buf[sizeof(struct usb_bench_stats)];
+	int rv;
+
+	rv = libusb_control_transfer(devh,
+		USB_RT_BENCH_GET_STATS & 0xff, USB_RT_BENCH_GET_STATS >> 8,
+		0, USB_BENCH_INTF, buf, sizeof(buf), TIMEOUT_MS);
+	if (rv != sizeof(buf)) {
+		fprintf(stderr, "[!] Failed to get device stats: %s\n",
+			rv < 0 ? libusb_error_name(rv) : "short read");
+		return -1;
+	}
+
+	printf("Device counters (tick %u):\n", get_le32(&buf[24]));
+	printf("  sink     %10u bytes  %8u xfers\n", get_le32(&buf[ 0]), get_le32(&buf[ 4]));
+	printf("  source   %10u bytes  %8u xfers\n", get_le32(&buf[ 8]), get_le32(&buf[12]));
+	printf("  loopback %10u bytes  %8u xfers\n", get_le32(&buf[16]), get_le32(&buf[20]));
+
+	return 0;
+}
+
+
+/* Streaming (sink / source) */
+/* ------------------------- */
+
+struct stream {
+	libusb_device_handle *devh;
+	uint8_t ep;
+
+	long long remaining;	/* Bytes not yet submitted */
+	long long done;		/* Bytes completed */
+	int in_flight;
+	int errors;
+
+	uint8_t expect;		/* Next expected source byte */
+	bool synced;
+	bool check_ok;
+
+	struct lat_stats lat;
+	struct {
+		struct libusb_transfer *xfer;
+		double t_submit;
+	} slot[MAX_QUEUE];
+};
+
+static void LIBUSB_CALL stream_cb(struct libusb_transfer *xfer);
+
+static void
+stream_submit(struct stream *s, int i)
+{
+	int len = g_opt.xfer_len;
+
+	if (s->remaining <= 0)
+		return;
+	if (len > s->remaining)
+		len = s->remaining;
+
+	libusb_fill_bulk_transfer(s->slot[i].xfer, s->devh, s->ep,
+		s->slot[i].xfer->buffer, len, stream_cb, s, TIMEOUT_MS);
+
+	s->slot[i].t_submit = now();
+	if (libusb_submit_transfer(s->slot[i].xfer)) {
+		s->errors++;
+		return;
+	}
+
+	s->remaining -= len;
+	s->in_flight++;
+}
+
+static void LIBUSB_CALL
+stream_cb(struct libusb_transfer *xfer)
+{
+	struct stream *s = xfer->user_data;
+	int i;
+
+	for (i=0; s->slot[i].xfer != xfer; i++);
+
+	s->in_flight--;
+
+	if (xfer->status != LIBUSB_TRANSFER_COMPLETED) {
+		fprintf(stderr, "[!] Transfer on EP %02x failed: %s\n",
+			s->ep, libusb_error_name(xfer->status));
+		s->errors++;
+		return;
+	}
+
+	lat_add(&s->lat, now() - s->slot[i].t_submit);
+	s->done += xfer->actual_length;
+
+	if ((s->ep & 0x80) && g_opt.check && xfer->actual_length) {
+		/* The device streams continuously, so sync on the first byte */
+		if (!s->synced) {
+			s->expect = xfer->buffer[0];
+			s->synced = true;
+		}
+		for (int j=0; j<xfer->actual_length; j++)
+			if (xfer->buffer[j] != s->expect++)
+				s->check_ok = false;
+	}
+
+	if (!s->errors)
+		stream_submit(s, i);
+}
+
+static int
+run_stream(libusb_device_handle *devh, uint8_t ep)
+{
+	struct stream s;
+	double t0, t1;
+	int i;
+
+	memset(&s, 0x00, sizeof(s));
+	s.devh = devh;
+	s.ep = ep;
+	s.remaining = (long long)g_opt.total_kb * 1024;
+	s.check_ok = true;
+
+	for (i=0; i<g_opt.queue; i++) {
+		s.slot[i].xfer = libusb_alloc_transfer(0);
+		s.slot[i].xfer->buffer = calloc(1, g_opt.xfer_len);
+	}
+
+	t0 = now();
+
+	for (i=0; i<g_opt.queue; i++)
+		stream_submit(&s, i);
+
+	while (s.in_flight)
+		libusb_handle_events(NULL);
+
+	t1 = now();
+
+	printf("%s (EP %02x, %d x %d bytes in flight):\n",
+		(ep & 0x80) ? "Source" : "Sink", ep, g_opt.queue, g_opt.xfer_len);
+	printf("  %lld bytes in %.3f s : %.3f MB/s\n",
+		s.done, t1 - t0, s.done / (t1 - t0) / 1e6);
+	lat_print("transfer latency", &s.lat);
+	if ((ep & 0x80) && g_opt.check)
+		printf("  data check             %s\n", s.check_ok ? "OK" : "FAILED");
+
+	for (i=0; i<g_opt.queue; i++) {
+		free(s.slot[i].xfer->buffer);
+		libusb_free_transfer(s.slot[i].xfer);
+	}
+
+	return (s.errors || !s.check_ok) ? -1 : 0;
+}
+
+
+/* Loopback */
+/* -------- */
+
+static int
+run_loopback(libusb_device_handle *devh)
+{
+	static const int sizes[] = { 1, 64, 256, 1024 };
+	uint8_t tx[USB_BENCH_XFER_LEN], rx[USB_BENCH_XFER_LEN];
+	int errors = 0;
+
+	printf("Loopback (EP %02x -> EP %02x, %d round trips per size):\n",
+		USB_BENCH_EP_LOOP_OUT, USB_BENCH_EP_LOOP_IN, g_opt.loop_iter);
+
+	for (unsigned int k=0; k<sizeof(sizes)/sizeof(sizes[0]); k++)
+	{
+		struct lat_stats ls;
+		char name[32];
+		int len = sizes[k];
+		double t0;
+
+		memset(&ls, 0x00, sizeof(ls));
+
+		for (int i=0; i<g_opt.loop_iter; i++)
+		{
+			int rv, xl;
+
+			for (int j=0; j<len; j++)
+				tx[j] = rand();
+
+			t0 = now();
+
+			rv = libusb_bulk_transfer(devh, USB_BENCH_EP_LOOP_OUT, tx, len, &xl, TIMEOUT_MS);
+			if (rv || (xl != len)) {
+				fprintf(stderr, "[!] Loopback OUT failed: %s\n", libusb_error_name(rv));
+				return -1;
+			}
+
+			/* Device only ends the OUT transfer on a short packet */
+			if (!(len % USB_BENCH_MPS) && (len < USB_BENCH_XFER_LEN))
+				libusb_bulk_transfer(devh, USB_BENCH_EP_LOOP_OUT, tx, 0, &xl, TIMEOUT_MS);
+
+			rv = libusb_bulk_transfer(devh, USB_BENCH_EP_LOOP_IN, rx, sizeof(rx), &xl, TIMEOUT_MS);
+			if (rv) {
+				fprintf(stderr, "[!] Loopback IN failed: %s\n", libusb_error_name(rv));
+				return -1;
+			}
+
+			lat_add(&ls, now() - t0);
+
+			if (g_opt.check && ((xl != len) || memcmp(tx, rx, len)))
+				errors++;
+		}
+
+		snprintf(name, sizeof(name), "%4d bytes round trip", len);
+		lat_print(name, &ls);
+	}
+
+	if (g_opt.check)
+		printf("  data check             %s\n", errors ? "FAILED" : "OK");
+
+	return errors ? -1 : 0;
+}
+
+
+/* Main */
+/* ---- */
+
+static void
+usage(const char *argv0)
+{
+	fprintf(stderr,
+		"Usage: %s [options] [sink] [source] [loop]\n"
+		"  -d vid:pid  Device to use (default %04x:%04x)\n"
+		"  -s bytes    Transfer size for sink / source (default %d)\n"
+		"  -q n        Transfers in flight for sink / source (default %d, max %d)\n"
+		"  -n kbytes   Amount of data for sink / source (default %d)\n"
+		"  -l n        Loopback round trips per size (default %d)\n"
+		"  -x          Don't check the data\n"
+		"Without test names, all of them are run.\n",
+		argv0, g_opt.vid, g_opt.pid, g_opt.xfer_len, g_opt.queue, MAX_QUEUE,
+		g_opt.total_kb, g_opt.loop_iter);
+}
+
+int main(int argc, char *argv[])
+{
+	libusb_device_handle *devh;
+	bool t_sink = false, t_source = false, t_loop = false;
+	unsigned int vid, pid;
+	int rv, opt, i;
+
+	while ((opt = getopt(argc, argv, "d:s:q:n:l:xh")) != -1) {
+		switch (opt) {
+		case 'd':
+			if (sscanf(optarg, "%x:%x", &vid, &pid) != 2) {
+				usage(argv[0]);
+				return 1;
+			}
+			g_opt.vid = vid;
+			g_opt.pid = pid;
+			break;
+		case 's': g_opt.xfer_len  = atoi(optarg); break;
+		case 'q': g_opt.queue     = atoi(optarg); break;
+		case 'n': g_opt.total_kb  = atoi(optarg); break;
+		case 'l': g_opt.loop_iter = atoi(optarg); break;
+		case 'x': g_opt.check     = false; break;
+		default:
+			usage(argv[0]);
+			return opt == 'h' ? 0 : 1;
+		}
+	}
+
+	if ((g_opt.queue < 1) || (g_opt.queue > MAX_QUEUE) || (g_opt.xfer_len < 1)) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	for (i=optind; i<argc; i++) {
+		if (!strcmp(argv[i], "sink"))
+			t_sink = true;
+		else if (!strcmp(argv[i], "source"))
+			t_source = true;
+		else if (!strcmp(argv[i], "loop"))
+			t_loop = true;
+		else {
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (!t_sink && !t_source && !t_loop)
+		t_sink = t_source = t_loop = true;
+
+	/* Open device */
+	rv = libusb_init(NULL);
+	if (rv) {
+		fprintf(stderr, "[!] libusb init failed: %s\n", libusb_error_name(rv));
+		return 1;
+	}
+
+	devh = libusb_open_device_with_vid_pid(NULL, g_opt.vid, g_opt.pid);
+	if (!devh) {
+		fprintf(stderr, "[!] Device %04x:%04x not found\n", g_opt.vid, g_opt.pid);
+		rv = 1;
+		goto out_exit;
+	}
+
+	rv = libusb_claim_interface(devh, USB_BENCH_INTF);
+	if (rv) {
+		fprintf(stderr, "[!] Can't claim interface %d (firmware built without BENCH=1 ?): %s\n",
+			USB_BENCH_INTF, libusb_error_name(rv));
+		rv = 1;
+		goto out_close;
+	}
+
+	/* Run tests */
+	stats_reset(devh);
+
+	rv = 0;
+
+	if (t_sink)
+		rv |= run_stream(devh, USB_BENCH_EP_SINK);
+
+	if (t_source)
+		rv |= run_stream(devh, USB_BENCH_EP_SOURCE);
+
+	if (t_loop)
+		rv |= run_loopback(devh);
+
+	stats_print(devh);
+
+	rv = rv ? 1 : 0;
+
+	libusb_release_interface(devh, USB_BENCH_INTF);
+out_close:
+	libusb_close(devh);
+out_exit:
+	libusb_exit(NULL);
+
+	return rv;
+}
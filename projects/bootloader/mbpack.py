@@ -0,0 +1,214 @@
+#!/usr/bin/env python3
+
+#
+# Compresses a flash image (multiboot.img) using all the cores.
+#
+# Usage: mbpack.py [-j jobs] [-b block_size] input output.{gz,mbz}
+#        mbpack.py -x input.mbz output
+#
+# Two output formats, picked by the extension :
+#
+#  - .gz  : a single gzip member with a 4 KB window, suitable for
+#           unzipping on devices with small RAM (micropython's uzlib,
+#           see esp32ecp5). The blocks are deflated in parallel, each
+#           one primed with the end of the previous block and ended on
+#           a byte boundary (Z_SYNC_FLUSH) so they can just be
+#           concatenated, like pigz does.
+#
+#  - .mbz : a block indexed container, so a reader can get to any
+#           block without inflating what comes before :
+#
+#      header (32 bytes, LE)
+#        magic 'MBZ1', u16 version, u16 header size,
+#        u32 block size, u32 block count, u32 image size,
+#        u32 CRC32 of the index, 8 bytes reserved (0)
+#
+#      index, one 12 bytes entry per block (LE)
+#        u32 offset of the data from the start of the file
+#        u24 compressed length, u8 type
+#        u32 CRC32 of the uncompressed block
+#
+#      block data, in order
+#
+#    Block types :
+#      0 erased   all 0xff, no data
+#      1 deflate  raw deflate stream, 4 KB window, independent
+#      2 stored   uncompressed (didn't compress)
+#
+#    The last block is padded with 0xff to the block size, the image
+#    size gives the real length.
+#
+# -x expands a .mbz and checks all the CRCs.
+#
+
+import concurrent.futures
+import getopt
+import os
+import struct
+import sys
+import zlib
+
+
+MBZ_MAGIC    = b'MBZ1'
+MBZ_VERSION  = 1
+MBZ_HDR      = struct.Struct('<4sHHIIII8x')
+MBZ_IDX      = struct.Struct('<III')
+
+BLK_ERASED   = 0
+BLK_DEFLATE  = 1
+BLK_STORED   = 2
+
+WBITS        = 12		# 4 KB window
+GZ_CHUNK     = 128 * 1024	# Parallel unit for .gz output
+
+
+def is_erased(blk):
+	return blk.count(0xff) == len(blk)
+
+
+# .mbz
+# ----
+
+def mbz_block(blk):
+	if is_erased(blk):
+		return BLK_ERASED, b''
+
+	comp = zlib.compressobj(level=9, wbits=-WBITS)
+	data = comp.compress(blk) + comp.flush()
+
+	if len(data) >= len(blk):
+		return BLK_STORED, blk
+
+	return BLK_DEFLATE, data
+
+
+def mbz_pack(img, block_size, pool):
+	# Pad to whole blocks
+	n_blk = (len(img) + block_size - 1) // block_size
+	img_p = img + b'\xff' * (n_blk * block_size - len(img))
+	blks  = [ img_p[i*block_size:(i+1)*block_size] for i in range(n_blk) ]
+
+	# zlib releases the GIL, so threads scale
+	res = list(pool.map(mbz_block, blks))
+
+	idx  = bytearray()
+	data = bytearray()
+	ofs  = MBZ_HDR.size + n_blk * MBZ_IDX.size
+
+	for blk, (t, d) in zip(blks, res):
+		idx  += MBZ_IDX.pack(ofs + len(data), len(d) | (t << 24), zlib.crc32(blk))
+		data += d
+
+	hdr = MBZ_HDR.pack(MBZ_MAGIC, MBZ_VERSION, MBZ_HDR.size,
+		block_size, n_blk, len(img), zlib.crc32(idx))
+
+	stats = [ sum(1 for t, _ in res if t == x) for x in (BLK_ERASED, BLK_DEFLATE, BLK_STORED) ]
+	sys.stderr.write('%d blocks of %d: %d erased, %d deflated, %d stored\n' % (
+		n_blk, block_size, *stats))
+
+	return hdr + idx + data
+
+
+def mbz_unpack(mbz):
+	magic, ver, hdr_size, block_size, n_blk, img_len, idx_crc = MBZ_HDR.unpack_from(mbz, 0)
+
+	if (magic != MBZ_MAGIC) or (ver != MBZ_VERSION):
+		raise ValueError('Not a MBZ%d file' % MBZ_VERSION)
+
+	idx = mbz[hdr_size:hdr_size + n_blk * MBZ_IDX.size]
+	if zlib.crc32(idx) != idx_crc:
+		raise ValueError('Index CRC error')
+
+	img = bytearray()
+
+	for i in range(n_blk):
+		ofs, lt, crc = MBZ_IDX.unpack_from(idx, i * MBZ_IDX.size)
+		t, l = lt >> 24, lt & 0xffffff
+		d = mbz[ofs:ofs+l]
+
+		if t == BLK_ERASED:
+			blk = b'\xff' * block_size
+		elif t == BLK_DEFLATE:
+			blk = zlib.decompress(d, wbits=-WBITS)
+		elif t == BLK_STORED:
+			blk = d
+		else:
+			raise ValueError('Block %d: Unknown type %d' % (i, t))
+
+		if (len(blk) != block_size) or (zlib.crc32(blk) != crc):
+			raise ValueError('Block %d: CRC error' % i)
+
+		img += blk
+
+	return bytes(img[:img_len])
+
+
+# .gz
+# ---
+
+def gz_chunk(args):
+	prev, chunk, last = args
+
+	# Primed with the previous window so the ratio matches a single
+	# stream, and ended on a byte boundary to be concatenated
+	comp = zlib.compressobj(level=9, wbits=-WBITS, zdict=prev) if prev else \
+	       zlib.compressobj(level=9, wbits=-WBITS)
+
+	return comp.compress(chunk) + comp.flush(zlib.Z_FINISH if last else zlib.Z_SYNC_FLUSH)
+
+
+def gz_pack(img, pool):
+	win   = 1 << WBITS
+	n     = max(1, (len(img) + GZ_CHUNK - 1) // GZ_CHUNK)
+	args  = [ (img[max(0, i*GZ_CHUNK - win):i*GZ_CHUNK], img[i*GZ_CHUNK:(i+1)*GZ_CHUNK], i == n - 1) for i in range(n) ]
+
+	# Header with the window size zlib would put (XFL = 2, max compression)
+	hdr  = b'\x1f\x8b\x08\x00\x00\x00\x00\x00\x02\xff'
+	body = b''.join(pool.map(gz_chunk, args))
+	tail = struct.pack('<II', zlib.crc32(img), len(img) & 0xffffffff)
+
+	return hdr + body + tail
+
+
+# Main
+# ----
+
+def main(argv0, *args):
+	jobs       = os.cpu_count()
+	block_size = 4096
+	extract    = False
+
+	opts, args = getopt.getopt(args, 'j:b:x')
+	for o, v in opts:
+		if o == '-j':
+			jobs = int(v)
+		elif o == '-b':
+			block_size = int(v, 0)
+		elif o == '-x':
+			extract = True
+
+	if (len(args) != 2) or (block_size & (block_size - 1)) or not (256 <= block_size <= 65536):
+		sys.stderr.write('Usage: %s [-j jobs] [-b block_size] input output.{gz,mbz}\n' % argv0)
+		sys.stderr.write('       %s -x input.mbz output\n' % argv0)
+		return 1
+
+	with open(args[0], 'rb') as fh:
+		src = fh.read()
+
+	if extract:
+		out = mbz_unpack(src)
+	else:
+		with concurrent.futures.ThreadPoolExecutor(jobs) as pool:
+			if args[1].endswith('.gz'):
+				out = gz_pack(src, pool)
+			else:
+				out = mbz_pack(src, block_size, pool)
+
+	with open(args[1], 'wb') as fh:
+		fh.write(out)
+
+	return 0
+
+
+if __name__ == '__main__':
+	sys.exit(main(*sys.argv))
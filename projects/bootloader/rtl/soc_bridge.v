@@ -39,7 +39,9 @@ module soc_bridge #(
 	parameter integer WB_DW  = 32,
 	parameter integer WB_AW  = 16,
 	parameter integer WB_AI  =  2,
-	parameter integer WB_REG = 0	// [0] = cyc / [1] = addr/wdata/wstrb / [2] = ack/rdata
+	parameter integer WB_REG = 0,	// [0] = cyc / [1] = addr/wdata/wstrb / [2] = ack/rdata
+					// [3] = posted writes (replaces [2:0])
+	parameter integer RAM_LA = 0	// BRAM reads from the look-ahead interface
 )(
 	/* PicoRV32 bus */
 	input  wire [31:0] pb_addr,
@@ -49,6 +51,9 @@ module soc_bridge #(
 	input  wire pb_valid,
 	output wire pb_ready,
 
+	input  wire [31:0] pb_la_addr,	// Only used if RAM_LA
+	input  wire pb_la_read,
+
 	/* BRAM */
 	output wire [RAM_AW-1:0] bram_addr,
 	input  wire [31:0] bram_rdata,
@@ -74,7 +79,7 @@ module soc_bridge #(
 	// -------
 
 	wire ram_sel;
-	reg  ram_rdy;
+	wire ram_rdy;
 	wire [31:0] ram_rdata;
 
 	(* keep="true" *) wire [WB_N-1:0] wb_match;
@@ -84,11 +89,17 @@ module soc_bridge #(
 	wire [31:0] wb_rdata_out;
 	wire wb_rdy;
 
+	wire wp_post;
+	reg  wp_busy;
+	reg  [WB_N-1:0] wp_cyc;
+	reg  [WB_AW-1:0] wp_addr;
+	reg  [WB_DW-1:0] wp_wdata;
+	reg  [(WB_DW/8)-1:0] wp_wmsk;
+
 
 	// RAM access
 	// ----------
 
-	assign bram_addr   = pb_addr[RAM_AW+1:2];
 	assign bram_wdata  = pb_wdata;
 	assign bram_wmsk   = pb_wstrb;
 	assign bram_we     = pb_valid & ~pb_addr[31] & |pb_wstrb & ~pb_addr[17];
@@ -97,8 +108,21 @@ module soc_bridge #(
 
 	assign ram_sel = pb_valid & ~pb_addr[31];
 
-	always @(posedge clk)
-		ram_rdy <= ram_sel && ~ram_rdy;
+	if (RAM_LA) begin
+		// Zero wait state: reads are issued from the look-ahead address
+		// the cycle before pb_valid, writes complete at the clock edge
+		assign bram_addr = pb_la_read ? pb_la_addr[RAM_AW+1:2] : pb_addr[RAM_AW+1:2];
+		assign ram_rdy = ram_sel;
+	end else begin
+		// One wait state for the read latency
+		reg ram_rdy_reg;
+
+		always @(posedge clk)
+			ram_rdy_reg <= ram_sel && ~ram_rdy_reg;
+
+		assign bram_addr = pb_addr[RAM_AW+1:2];
+		assign ram_rdy = ram_rdy_reg;
+	end
 
 
 	// Wishbone
@@ -110,7 +134,37 @@ module soc_bridge #(
 	for (i=0; i<WB_N; i=i+1)
 		assign wb_match[i] = (pb_addr[27:24] == i);
 
-	if (WB_REG & 1) begin
+	if (WB_REG & 8) begin
+		// Posted writes: the write is latched and acked to the CPU right
+		// away while the wishbone cycle runs in the background. Any other
+		// wishbone access waits for it to complete. Reads are direct.
+		assign wp_post = pb_valid & pb_addr[31] & |pb_wstrb & ~wp_busy;
+
+		always @(posedge clk)
+			if (rst)
+				wp_busy <= 1'b0;
+			else if (wp_post)
+				wp_busy <= 1'b1;
+			else if (|(wp_cyc & wb_ack))
+				wp_busy <= 1'b0;
+
+		always @(posedge clk)
+			if (rst)
+				wp_cyc <= 0;
+			else if (wp_post)
+				wp_cyc <= wb_match;
+			else if (|(wp_cyc & wb_ack))
+				wp_cyc <= 0;
+
+		always @(posedge clk)
+			if (wp_post) begin
+				wp_addr  <= pb_addr[WB_AW+WB_AI-1:WB_AI];
+				wp_wdata <= pb_wdata[WB_DW-1:0];
+				wp_wmsk  <= pb_wstrb[(WB_DW/8)-1:0];
+			end
+
+		assign wb_cyc = wp_busy ? wp_cyc : ((wb_cyc_rst | |pb_wstrb) ? { WB_N{1'b0} } : wb_match);
+	end else if (WB_REG & 1) begin
 		// Register
 		reg [WB_N-1:0] wb_cyc_reg;
 		always @(posedge clk)
@@ -125,7 +179,13 @@ module soc_bridge #(
 	end
 
 	// Addr / Write-Data / Write-Mask / Write-Enable
-	if (WB_REG & 2) begin
+	if (WB_REG & 8) begin
+		// Posted
+		assign wb_addr  = wp_busy ? wp_addr : pb_addr[WB_AW+WB_AI-1:WB_AI];
+		assign wb_wdata = wp_wdata;
+		assign wb_wmsk  = wp_wmsk;
+		assign wb_we    = wp_busy;
+	end else if (WB_REG & 2) begin
 		// Register
 		reg [WB_AW-1:0] wb_addr_reg;
 		reg [WB_DW-1:0] wb_wdata_reg;
@@ -161,7 +221,12 @@ module soc_bridge #(
 			wb_rdata_or[WB_DW-1:0] = wb_rdata_or[WB_DW-1:0] | wb_rdata[WB_DW*i+:WB_DW];
 	end
 
-	if (WB_REG & 4) begin
+	if (WB_REG & 8) begin
+		// Posted, the write acks never reach the CPU
+		assign wb_cyc_rst = ~pb_valid | ~pb_addr[31];
+		assign wb_rdy = wp_post | (~wp_busy & ~|pb_wstrb & |wb_ack);
+		assign wb_rdata_out = (wp_busy | wb_cyc_rst) ? 32'h00000000 : wb_rdata_or;
+	end else if (WB_REG & 4) begin
 		// Register
 		reg wb_rdy_reg;
 		reg [31:0] wb_rdata_reg;
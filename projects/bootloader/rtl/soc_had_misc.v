@@ -89,6 +89,9 @@ module soc_had_misc (
 	reg  we_ctrl;
 	reg  we_led_pwm;
 	reg  we_lcd_fifo;
+	reg  we_blit_data;
+	reg  we_blit_pal;
+	reg  we_blit_ctrl;
 
 	wire rd_rst;
 
@@ -121,12 +124,46 @@ module soc_had_misc (
 	wire [17:0] lcd_db_io;
 	wire [ 1:0] lcd_ctrl_io;
 
+	wire [17:0] lcd_out_data;
+	wire lcd_out_rs;
+	wire lcd_out_wr;
+
+	// Blitter
+	wire [31:0] bf_di;
+	wire bf_wren;
+	wire bf_full;
+
+	wire [31:0] bf_do;
+	wire bf_rden;
+	wire bf_empty;
+
+	reg  [17:0] blit_pal [0:15];
+	reg  [23:0] blit_pix_left;
+	wire blit_active;
+
+	localparam [2:0]
+		BS_CMD  = 3'd0,
+		BS_EXT1 = 3'd1,
+		BS_EXT2 = 3'd2,
+		BS_EXT3 = 3'd3,
+		BS_DRAW = 3'd4;
+
+	reg  [2:0] blit_state;
+	reg  [1:0] blit_bidx;
+	wire [7:0] blit_byte;
+	wire blit_byte_take;
+	reg  [7:0] blit_cnt_lsb;
+	reg  [16:0] blit_cnt;
+	reg  [3:0] blit_col;
+	reg  blit_ph;
+	wire blit_last;
+
 
 	// Bus interface
 	// -------------
 
-	// Ack
-	assign ack_nxt = ~ack & bus_cyc;
+	// Ack (writes to the blitter FIFO wait for space)
+	assign ack_nxt = ~ack & bus_cyc & ~(bus_we & (bus_addr == 4'h4) & bf_full);
 
 	always @(posedge clk)
 		ack <= ack_nxt;
@@ -136,9 +173,12 @@ module soc_had_misc (
 	// Write enable
 	always @(posedge clk)
 	begin
-		we_ctrl     <= ack_nxt & bus_we & (bus_addr[1:0] == 2'b00);
-		we_led_pwm  <= ack_nxt & bus_we & (bus_addr[1:0] == 2'b01);
-		we_lcd_fifo <= ack_nxt & bus_we &  bus_addr[1];
+		we_ctrl      <= ack_nxt & bus_we & (bus_addr == 4'h0);
+		we_led_pwm   <= ack_nxt & bus_we & (bus_addr == 4'h1);
+		we_lcd_fifo  <= ack_nxt & bus_we & (bus_addr[3:1] == 3'b001);
+		we_blit_data <= ack_nxt & bus_we & (bus_addr == 4'h4);
+		we_blit_pal  <= ack_nxt & bus_we & (bus_addr == 4'h5);
+		we_blit_ctrl <= ack_nxt & bus_we & (bus_addr == 4'h6);
 	end
 
 	// Write
@@ -171,7 +211,9 @@ module soc_had_misc (
 		if (rd_rst)
 			bus_rdata <= 32'h00000000;
 		else
-			bus_rdata <= bus_addr[0] ?
+			bus_rdata <= bus_addr[2] ?
+				{ blit_active, 7'd0, blit_pix_left } :
+				bus_addr[0] ?
 				{ 2'b00, led_pwm } :
 				//{ boot_key, btn_val, lcd_rst_i, fsel_c, fsel_d, 3'd0, led_ena };
 				{ boot_key, btn_val, lcd_rst_i, fsel_c, fsel_d, 5'd0, led_ena };
@@ -264,13 +306,19 @@ module soc_had_misc (
 	// ---
 
 	// Generate write pulse. Rest is mapped directly from WB
-	assign lcd_wr_i = ~(ack_nxt & bus_addr[1]);
+	assign lcd_wr_i = ~(ack_nxt & (bus_addr[3:1] == 3'b001));
+
+	// Blitter has the bus while it's drawing. Direct writes must wait
+	// for it to be done (see status register)
+	assign lcd_out_data = blit_active ? blit_pal[blit_col] : bus_wdata[17:0];
+	assign lcd_out_rs   = blit_active ? 1'b1 : bus_addr[0];
+	assign lcd_out_wr   = blit_active ? ~(blit_state == BS_DRAW & ~blit_ph) : lcd_wr_i;
 
 	// PHY (just put IO registers on all signals since we don't support reads)
 	/*
 	OFS1P3DX lcd_or_data_I[17:0] (
 		.CD(rst),
-		.D(bus_wdata[17:0]),
+		.D(lcd_out_data),
 		.SP(1'b1),
 		.SCLK(clk),
 		.Q(lcd_db_io)
@@ -287,7 +335,7 @@ module soc_had_misc (
 
 	OFS1P3DX lcd_or_ctrl_I[1:0] (
 		.CD(rst),
-		.D({bus_addr[0], lcd_wr_i}),
+		.D({lcd_out_rs, lcd_out_wr}),
 		.SP(1'b1),
 		.SCLK(clk),
 		.Q(lcd_ctrl_io)
@@ -308,4 +356,116 @@ module soc_had_misc (
 	assign lcd_rst = lcd_rst_i;
 	*/
 
+
+	// LCD Blitter
+	// -----------
+	//
+	// Draws a RLE stream in the lcd_logo[] format, 4 bytes per word, first
+	// byte in the LSBs. Each byte is a command : [7:4] repeat count - 1
+	// and [3:0] palette index. A count of 0xf is followed by one byte
+	// n (n + 16 pixels) or by 0xff and a 16 bits little endian n (n + 271
+	// pixels). Writing the pixel count to the control register starts it,
+	// it stops once that many pixels are drawn, dropping any leftover
+	// stream bytes (and any written while idle). One pixel every 2 clocks.
+	//
+	// 4 : Stream data (W)
+	// 5 : Palette : [31:28] index, [17:0] colour (W)
+	// 6 : Control : [23:0] pixel count (W) / [31] busy, [23:0] pixels left (R)
+
+	// Palette
+	always @(posedge clk)
+		if (we_blit_pal)
+			blit_pal[bus_wdata[31:28]] <= bus_wdata[17:0];
+
+	// Stream FIFO
+	assign bf_di   = bus_wdata;
+	assign bf_wren = we_blit_data;
+
+	fifo_sync_ram #(
+		.DEPTH(32),
+		.WIDTH(32)
+	) blit_fifo_I (
+		.wr_data(bf_di),
+		.wr_ena(bf_wren),
+		.wr_full(bf_full),
+		.rd_data(bf_do),
+		.rd_ena(bf_rden),
+		.rd_empty(bf_empty),
+		.level(),
+		.afull_thr(6'd0),
+		.wr_afull(),
+		.aempty_thr(6'd0),
+		.rd_aempty(),
+		.clk(clk),
+		.rst(rst)
+	);
+
+	// Byte extraction, words are dropped once done
+	assign blit_byte = bf_do[8*blit_bidx+:8];
+
+	assign blit_byte_take = ~bf_empty & (~blit_active | (blit_state != BS_DRAW));
+	assign bf_rden = blit_byte_take & ((blit_bidx == 2'b11) | ~blit_active);
+
+	always @(posedge clk)
+		if (rst | we_blit_ctrl)
+			blit_bidx <= 2'b00;
+		else if (blit_byte_take)
+			blit_bidx <= blit_active ? (blit_bidx + 1) : 2'b00;
+
+	// Decoder / Draw
+	assign blit_active = (blit_pix_left != 0);
+	assign blit_last = (blit_cnt == 0) | (blit_pix_left == 1);
+
+	always @(posedge clk)
+		if (rst | we_blit_ctrl) begin
+			blit_state <= BS_CMD;
+			blit_ph    <= 1'b0;
+		end else if (blit_active)
+			case (blit_state)
+				BS_CMD:
+					if (blit_byte_take) begin
+						blit_col   <= blit_byte[3:0];
+						blit_cnt   <= blit_byte[7:4];
+						blit_state <= (blit_byte[7:4] == 4'hf) ? BS_EXT1 : BS_DRAW;
+					end
+
+				BS_EXT1:
+					if (blit_byte_take) begin
+						blit_cnt   <= blit_byte + 15;
+						blit_state <= (blit_byte == 8'hff) ? BS_EXT2 : BS_DRAW;
+					end
+
+				BS_EXT2:
+					if (blit_byte_take) begin
+						blit_cnt_lsb <= blit_byte;
+						blit_state   <= BS_EXT3;
+					end
+
+				BS_EXT3:
+					if (blit_byte_take) begin
+						blit_cnt   <= { blit_byte, blit_cnt_lsb } + 270;
+						blit_state <= BS_DRAW;
+					end
+
+				BS_DRAW: begin
+					blit_ph <= ~blit_ph;
+					if (blit_ph) begin
+						blit_cnt <= blit_cnt - 1;
+						if (blit_last)
+							blit_state <= BS_CMD;
+					end
+				end
+
+				default:
+					blit_state <= BS_CMD;
+			endcase
+
+	always @(posedge clk)
+		if (rst)
+			blit_pix_left <= 24'h000000;
+		else if (we_blit_ctrl)
+			blit_pix_left <= bus_wdata[23:0];
+		else if ((blit_state == BS_DRAW) & blit_ph)
+			blit_pix_left <= blit_pix_left - 1;
+
 endmodule // soc_had_misc
@@ -33,10 +33,13 @@
 
 `default_nettype none
 
-module sysmgr (
+module sysmgr #(
+	parameter integer CPU_DIV = 10	// CPU clock = 480 MHz / CPU_DIV (10 = 48 MHz)
+)(
 	input  wire clk_in,
 	input  wire rst_in,
 	output wire clk_48m,
+	output wire clk_cpu,
 	output wire rst_out,
 	output wire locked
 );
@@ -49,6 +52,7 @@ module sysmgr (
 
 	wire clk_48m_p;
 	wire clk_48m_s;
+	wire clk_cpu_s;
 	wire rst_i;
 	reg [7:0] rst_cnt;
 
@@ -75,6 +79,10 @@ EHXPLLL #(
         .CLKOS_DIV(10),
         .CLKOS_CPHASE(0),
         .CLKOS_FPHASE(0),
+        .CLKOS2_ENABLE("ENABLED"),
+        .CLKOS2_DIV(CPU_DIV),
+        .CLKOS2_CPHASE(0),
+        .CLKOS2_FPHASE(0),
         .FEEDBK_PATH("CLKOP"),
         .CLKFB_DIV(2)
     ) pll_i (
@@ -83,6 +91,7 @@ EHXPLLL #(
         .CLKI(clk_in),
         .CLKOP(clk_48m_p),
         .CLKOS(clk_48m_s),
+        .CLKOS2(clk_cpu_s),
         .CLKFB(clk_48m_p),
         .CLKINTFB(),
         .PHASESEL0(1'b0),
@@ -96,6 +105,7 @@ EHXPLLL #(
         );
            
 	assign clk_48m = clk_48m_s;
+	assign clk_cpu = clk_cpu_s;
 
 	// PLL reset generation
 	assign pll_reset = rst_in;
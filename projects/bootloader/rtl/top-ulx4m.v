@@ -120,6 +120,11 @@ module top
 	localparam WB_AW = 16;
 	localparam WB_AI =  2;
 
+`ifndef CPU_DIV
+`define CPU_DIV 10
+`endif
+	localparam CPU_DIV = `CPU_DIV;	/* CPU clock = 480 MHz / CPU_DIV, 10 = 48 MHz (see Makefile) */
+
 
 	// Signals
 	// -------
@@ -132,6 +137,8 @@ module top
 	wire [31:0] mem_rdata;
 	wire [31:0] mem_wdata;
 	wire [ 3:0] mem_wstrb;
+	wire        mem_la_read;
+	wire [31:0] mem_la_addr;
 
 	// BRAM
 	wire [RAM_AW-1:0] bram_addr;
@@ -150,6 +157,19 @@ module top
 	wire wb_we;
 	wire [WB_N-1:0] wb_ack;
 
+	// Wishbone in the USB clock domain (peripherals [2:0])
+	wire [WB_AW-1:0] wbs_addr;
+	wire [WB_DW-1:0] wbs_wdata;
+	wire [WB_DW-1:0] wbs_rdata [0:2];
+	wire [2:0] wbs_sel;
+	wire [2:0] wbs_cyc;
+	wire wbs_cyc_i;
+	wire wbs_we;
+	wire [2:0] wbs_ack;
+
+	wire [WB_DW-1:0] wbx_rdata;
+	wire wbx_ack;
+
 	// USB EP Buffer
 	wire [ 8:0] ep_tx_addr_0;
 	wire [31:0] ep_tx_data_0;
@@ -168,6 +188,7 @@ module top
 
 	// Clocks / Reset
 	wire clk_48m;
+	wire clk_cpu;
 	wire rst;
 
 	// Genvar
@@ -244,7 +265,7 @@ module top
 		.CATCH_MISALIGN(0),
 		.CATCH_ILLINSN(0)
 	) cpu_I (
-		.clk       (clk_48m),
+		.clk       (clk_cpu),
 		.resetn    (~rst),
 		.mem_valid (mem_valid),
 		.mem_instr (mem_instr),
@@ -252,7 +273,9 @@ module top
 		.mem_addr  (mem_addr),
 		.mem_wdata (mem_wdata),
 		.mem_wstrb (mem_wstrb),
-		.mem_rdata (mem_rdata)
+		.mem_rdata (mem_rdata),
+		.mem_la_read (mem_la_read),
+		.mem_la_addr (mem_la_addr)
 	);
 
 	// Bridge
@@ -261,7 +284,9 @@ module top
 		.WB_N(WB_N),
 		.WB_DW(WB_DW),
 		.WB_AW(WB_AW),
-		.WB_AI(WB_AI)
+		.WB_AI(WB_AI),
+		.WB_REG(8),
+		.RAM_LA(1)
 	) pb_I (
 		.pb_addr(mem_addr),
 		.pb_rdata(mem_rdata),
@@ -269,6 +294,8 @@ module top
 		.pb_wstrb(mem_wstrb),
 		.pb_valid(mem_valid),
 		.pb_ready(mem_ready),
+		.pb_la_addr(mem_la_addr),
+		.pb_la_read(mem_la_read),
 		.bram_addr(bram_addr),
 		.bram_rdata(bram_rdata),
 		.bram_wdata(bram_wdata),
@@ -281,7 +308,7 @@ module top
 		.wb_cyc(wb_cyc),
 		.wb_we(wb_we),
 		.wb_ack(wb_ack),
-		.clk(clk_48m),
+		.clk(clk_cpu),
 		.rst(rst)
 	);
 
@@ -298,7 +325,7 @@ module top
 		.wdata(bram_wdata),
 		.wmsk(bram_wmsk),
 		.we(bram_we),
-		.clk(clk_48m)
+		.clk(clk_cpu)
 	);
 
 	// BTN remapper (after debouncer in soc_had_misc)
@@ -323,12 +350,12 @@ module top
 		.btn_remap_o(btn_remap_o),
 		.btn_remap_i(btn_remap_i),
 		.programn(user_programn),
-		.bus_addr(wb_addr[3:0]),
-		.bus_wdata(wb_wdata),
-		.bus_rdata(wb_rdata[0]),
-		.bus_cyc(wb_cyc[0]),
-		.bus_ack(wb_ack[0]),
-		.bus_we(wb_we),
+		.bus_addr(wbs_addr[3:0]),
+		.bus_wdata(wbs_wdata),
+		.bus_rdata(wbs_rdata[0]),
+		.bus_cyc(wbs_cyc[0]),
+		.bus_ack(wbs_ack[0]),
+		.bus_we(wbs_we),
 		//.fsel_c(fsel_c),
 		//.fsel_d(fsel_d),
 		.clk(clk_48m),
@@ -337,17 +364,18 @@ module top
 
 	// Peripheral [1] : UART
 	uart_wb #(
+		.FIFO_DEPTH(512),
 		.DIV_WIDTH(16),
 		.DW(WB_DW)
 	) uart_I (
 		.uart_tx(boot_uart_txd),
 		.uart_rx(boot_uart_rxd),
-		.bus_addr(wb_addr[1:0]),
-		.bus_wdata(wb_wdata),
-		.bus_rdata(wb_rdata[1]),
-		.bus_cyc(wb_cyc[1]),
-		.bus_ack(wb_ack[1]),
-		.bus_we(wb_we),
+		.bus_addr(wbs_addr[1:0]),
+		.bus_wdata(wbs_wdata),
+		.bus_rdata(wbs_rdata[1]),
+		.bus_cyc(wbs_cyc[1]),
+		.bus_ack(wbs_ack[1]),
+		.bus_we(wbs_we),
 		.clk(clk_48m),
 		.rst(rst)
 	);
@@ -366,23 +394,56 @@ module top
 		.ep_rx_addr_0(ep_rx_addr_0),
 		.ep_rx_data_1(ep_rx_data_1),
 		.ep_rx_re_0(ep_rx_re_0),
-		.ep_clk(clk_48m),
-		.bus_addr(wb_addr[11:0]),
-		.bus_din(wb_wdata[15:0]),
-		.bus_dout(wb_rdata[2][15:0]),
-		.bus_cyc(wb_cyc[2]),
-		.bus_we(wb_we),
-		.bus_ack(wb_ack[2]),
+		.ep_clk(clk_cpu),
+		.bus_addr(wbs_addr[11:0]),
+		.bus_din(wbs_wdata[15:0]),
+		.bus_dout(wbs_rdata[2][15:0]),
+		.bus_cyc(wbs_cyc[2]),
+		.bus_we(wbs_we),
+		.bus_ack(wbs_ack[2]),
 		.clk(clk_48m),
 		.rst(rst)
 	);
 
-	assign wb_rdata[2][31:16] = 16'h0000;
+	assign wbs_rdata[2][31:16] = 16'h0000;
+
+	// Peripherals [2:0] : Clock domain crossing
+		// The selected peripheral is passed along with the address.
+		// Writes are posted, reads have side effects so no prefetch.
+	xclk_wb_pipe #(
+		.DW(WB_DW),
+		.AW(WB_AW+3),
+		.PREFETCH(0)
+	) xclk_wb_I (
+		.s_addr({wb_cyc[2:0], wb_addr}),
+		.s_wdata(wb_wdata),
+		.s_rdata(wbx_rdata),
+		.s_cyc(|wb_cyc[2:0]),
+		.s_ack(wbx_ack),
+		.s_we(wb_we),
+		.s_clk(clk_cpu),
+		.m_addr({wbs_sel, wbs_addr}),
+		.m_wdata(wbs_wdata),
+		.m_rdata(wbs_rdata[0] | wbs_rdata[1] | wbs_rdata[2]),
+		.m_cyc(wbs_cyc_i),
+		.m_ack(|wbs_ack),
+		.m_we(wbs_we),
+		.m_clk(clk_48m),
+		.rst(rst)
+	);
+
+	assign wbs_cyc = wbs_sel & { 3{wbs_cyc_i} };
+
+	assign wb_ack[2:0] = wb_cyc[2:0] & { 3{wbx_ack} };
+
+	assign wb_rdata[0] = wbx_rdata;
+	assign wb_rdata[1] = 32'h00000000;
+	assign wb_rdata[2] = 32'h00000000;
 
 	// Peripheral [3] : USB Core buffers
 	reg wb_ack_ep;
 
-	always @(posedge clk_48m)
+	always @(posedge clk_cpu)
 		wb_ack_ep <= wb_cyc[3] & ~wb_ack_ep;
 
 	assign wb_ack[3] = wb_ack_ep;
@@ -418,7 +479,7 @@ module top
 		.bus_cyc(wb_cyc[4]),
 		.bus_we(wb_we),
 		.bus_ack(wb_ack[4]),
-		.clk(clk_48m),
+		.clk(clk_cpu),
 		.rst(rst)
 	);
 
@@ -435,7 +496,7 @@ module top
 		.spi_io_t(spi_cs_o[0] ? 4'hf : spi_io_t),
 		.spi_sck_o(spi_cs_o[0] ? 1'b0 : spi_sck_o),
 		.spi_cs_o(spi_cs_o[0]),
-		.clk(clk_48m),
+		.clk(clk_cpu),
 		.rst(rst)
 	);
 
@@ -452,10 +513,13 @@ module top
 	// Clock / Reset
 	// -------------
 
-	sysmgr sysmgr_I (
+	sysmgr #(
+		.CPU_DIV(CPU_DIV)
+	) sysmgr_I (
 		.clk_in(clk_25mhz),
 		.rst_in(1'b0),
 		.clk_48m(clk_48m),
+		.clk_cpu(clk_cpu),
 		.rst_out(rst),
 		.locked(locked)
 	);